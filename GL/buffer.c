@@ -0,0 +1,289 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "private.h"
+
+static NamedArray BUFFERS;
+static BufferObject* ARRAY_BUFFER = NULL;
+static BufferObject* ELEMENT_ARRAY_BUFFER = NULL;
+
+
+void _glInitBuffers() {
+    named_array_init(&BUFFERS, sizeof(BufferObject), 256);
+
+    // Reserve zero so that it is never given to anyone as an ID!
+    named_array_reserve(&BUFFERS, 0);
+}
+
+BufferObject* _glGetBoundBuffer(GLenum target) {
+    switch(target) {
+        case GL_ARRAY_BUFFER_ARB:
+            return ARRAY_BUFFER;
+        case GL_ELEMENT_ARRAY_BUFFER_ARB:
+            return ELEMENT_ARRAY_BUFFER;
+        default:
+            return NULL;
+    }
+}
+
+static GLboolean _glBufferExists(GLuint id) {
+    return id && id < BUFFERS.max_element_count && named_array_used(&BUFFERS, id);
+}
+
+static BufferObject** _glBufferTarget(GLenum target, const char* func) {
+    switch(target) {
+        case GL_ARRAY_BUFFER_ARB:
+            return &ARRAY_BUFFER;
+        case GL_ELEMENT_ARRAY_BUFFER_ARB:
+            return &ELEMENT_ARRAY_BUFFER;
+        default:
+            _glKosThrowError(GL_INVALID_ENUM, func);
+            return NULL;
+    }
+}
+
+static BufferObject* _glBoundBufferOrError(GLenum target, const char* func) {
+    BufferObject** bound = _glBufferTarget(target, func);
+
+    if(!bound) {
+        return NULL;
+    }
+
+    if(!*bound) {
+        _glKosThrowError(GL_INVALID_OPERATION, func);
+        return NULL;
+    }
+
+    return *bound;
+}
+
+/* Attribute pointers are stored already offset into the buffer's data, so
+ * they have to follow it when it's reallocated (or go when it's deleted) */
+static void _glRebaseAttribPointers(BufferObject* buffer, GLubyte* data) {
+    AttribPointer* pointers[] = {
+        &ATTRIB_POINTERS.vertex,
+        &ATTRIB_POINTERS.colour,
+        &ATTRIB_POINTERS.uv,
+        &ATTRIB_POINTERS.st,
+        &ATTRIB_POINTERS.normal
+    };
+
+    for(GLuint i = 0; i < sizeof(pointers) / sizeof(pointers[0]); ++i) {
+        AttribPointer* p = pointers[i];
+
+        if(p->buffer != buffer) {
+            continue;
+        }
+
+        if(data) {
+            p->ptr = data + ((const GLubyte*) p->ptr - buffer->data);
+        } else {
+            p->ptr = NULL;
+            p->buffer = NULL;
+        }
+    }
+}
+
+/* Strips are worked out from the indices, so go when they change */
+static void _glClearStrips(BufferObject* buffer) {
+    aligned_vector_clear(&buffer->strips);
+    aligned_vector_clear(&buffer->strip_indices);
+    aligned_vector_clear(&buffer->strip_ends);
+}
+
+void APIENTRY glGenBuffersARB(GLsizei n, GLuint* buffers) {
+    TRACE();
+
+    while(n--) {
+        GLuint id = 0;
+        BufferObject* buffer = (BufferObject*) named_array_alloc(&BUFFERS, &id);
+
+        if(!buffer) {
+            _glKosThrowError(GL_OUT_OF_MEMORY, __func__);
+            return;
+        }
+
+        memset(buffer, 0, sizeof(BufferObject));
+        buffer->index = id;
+        buffer->usage = GL_STATIC_DRAW_ARB;
+
+        aligned_vector_init(&buffer->converted_vertices, sizeof(Vertex));
+        aligned_vector_init(&buffer->converted_extras, sizeof(VertexExtra));
+        aligned_vector_init(&buffer->strips, sizeof(StripList));
+        aligned_vector_init(&buffer->strip_indices, sizeof(GLuint));
+        aligned_vector_init(&buffer->strip_ends, sizeof(GLuint));
+
+        *buffers = id;
+        buffers++;
+    }
+}
+
+void APIENTRY glDeleteBuffersARB(GLsizei n, const GLuint* buffers) {
+    TRACE();
+
+    while(n--) {
+        const GLuint id = *buffers++;
+
+        if(!_glBufferExists(id)) {
+            continue;
+        }
+
+        BufferObject* buffer = (BufferObject*) named_array_get(&BUFFERS, id);
+
+        if(buffer == ARRAY_BUFFER) {
+            ARRAY_BUFFER = NULL;
+        }
+
+        if(buffer == ELEMENT_ARRAY_BUFFER) {
+            ELEMENT_ARRAY_BUFFER = NULL;
+        }
+
+        _glRebaseAttribPointers(buffer, NULL);
+
+        free(buffer->data);
+        aligned_vector_cleanup(&buffer->converted_vertices);
+        aligned_vector_cleanup(&buffer->converted_extras);
+        aligned_vector_cleanup(&buffer->strips);
+        aligned_vector_cleanup(&buffer->strip_indices);
+        aligned_vector_cleanup(&buffer->strip_ends);
+
+        named_array_release(&BUFFERS, id);
+    }
+}
+
+void APIENTRY glBindBufferARB(GLenum target, GLuint buffer) {
+    TRACE();
+
+    BufferObject** bound = _glBufferTarget(target, __func__);
+
+    if(!bound) {
+        return;
+    }
+
+    if(buffer && !_glBufferExists(buffer)) {
+        _glKosThrowError(GL_INVALID_OPERATION, __func__);
+        return;
+    }
+
+    *bound = (buffer) ? (BufferObject*) named_array_get(&BUFFERS, buffer) : NULL;
+}
+
+void APIENTRY glBufferDataARB(GLenum target, GLsizeiptrARB size, const GLvoid* data, GLenum usage) {
+    TRACE();
+
+    GLint validUsages[] = {
+        GL_STREAM_DRAW_ARB,
+        GL_STREAM_READ_ARB,
+        GL_STREAM_COPY_ARB,
+        GL_STATIC_DRAW_ARB,
+        GL_STATIC_READ_ARB,
+        GL_STATIC_COPY_ARB,
+        GL_DYNAMIC_DRAW_ARB,
+        GL_DYNAMIC_READ_ARB,
+        GL_DYNAMIC_COPY_ARB,
+        0
+    };
+
+    if(_glCheckValidEnum(usage, validUsages, __func__) != 0) {
+        return;
+    }
+
+    if(size < 0) {
+        _glKosThrowError(GL_INVALID_VALUE, __func__);
+        return;
+    }
+
+    BufferObject* buffer = _glBoundBufferOrError(target, __func__);
+
+    if(!buffer) {
+        return;
+    }
+
+    GLubyte* storage = (GLubyte*) realloc(buffer->data, (size) ? size : 1);
+
+    if(!storage) {
+        _glKosThrowError(GL_OUT_OF_MEMORY, __func__);
+        return;
+    }
+
+    if(data) {
+        memcpy(storage, data, size);
+    }
+
+    _glRebaseAttribPointers(buffer, storage);
+
+    buffer->data = storage;
+    buffer->size = size;
+    buffer->usage = usage;
+    buffer->converted_valid = GL_FALSE;
+
+    _glClearStrips(buffer);
+
+    /* Only static buffers are worth converting */
+    if(usage != GL_STATIC_DRAW_ARB) {
+        aligned_vector_cleanup(&buffer->converted_vertices);
+        aligned_vector_cleanup(&buffer->converted_extras);
+    }
+}
+
+void APIENTRY glBufferSubDataARB(GLenum target, GLintptrARB offset, GLsizeiptrARB size, const GLvoid* data) {
+    TRACE();
+
+    BufferObject* buffer = _glBoundBufferOrError(target, __func__);
+
+    if(!buffer) {
+        return;
+    }
+
+    if(offset < 0 || size < 0 || offset + size > buffer->size) {
+        _glKosThrowError(GL_INVALID_VALUE, __func__);
+        return;
+    }
+
+    memcpy(buffer->data + offset, data, size);
+    buffer->converted_valid = GL_FALSE;
+
+    _glClearStrips(buffer);
+}
+
+void APIENTRY glGetBufferSubDataARB(GLenum target, GLintptrARB offset, GLsizeiptrARB size, GLvoid* data) {
+    TRACE();
+
+    BufferObject* buffer = _glBoundBufferOrError(target, __func__);
+
+    if(!buffer) {
+        return;
+    }
+
+    if(offset < 0 || size < 0 || offset + size > buffer->size) {
+        _glKosThrowError(GL_INVALID_VALUE, __func__);
+        return;
+    }
+
+    memcpy(data, buffer->data + offset, size);
+}
+
+void APIENTRY glGetBufferParameterivARB(GLenum target, GLenum pname, GLint* params) {
+    TRACE();
+
+    BufferObject* buffer = _glBoundBufferOrError(target, __func__);
+
+    if(!buffer) {
+        return;
+    }
+
+    switch(pname) {
+        case GL_BUFFER_SIZE_ARB:
+            *params = buffer->size;
+        break;
+        case GL_BUFFER_USAGE_ARB:
+            *params = buffer->usage;
+        break;
+        default:
+            _glKosThrowError(GL_INVALID_ENUM, __func__);
+    }
+}
+
+GLboolean APIENTRY glIsBufferARB(GLuint buffer) {
+    return _glBufferExists(buffer);
+}
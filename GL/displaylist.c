@@ -0,0 +1,450 @@
+/*
+ * Display lists record draws as vertices which have already been read and
+ * converted from the user's arrays (or glBegin/glEnd), along with the state
+ * changes made between them. Calling a list copies the vertices straight into
+ * the submission, so only the transform is left to do.
+ *
+ * Only the calls which check LIST_COMPILING are recorded. Texture uploads,
+ * object creation and deletion, pixel store and client array state still run
+ * immediately while compiling. Calls taking both enums and floats
+ * (lights, materials, fog and the alpha test) store the enums as floats, and
+ * single values are replayed through the vector form of the call. Lighting,
+ * material and fog calls with a pname that isn't understood aren't recorded,
+ * and raise their error straight away.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "private.h"
+
+typedef struct {
+    ListCommandType type;
+    union {
+        GLfloat f[16];
+        GLuint u[16];
+    } args;
+} ListCommand;
+
+typedef struct {
+    AlignedVector commands; /* ListCommand */
+    AlignedVector vertices; /* Vertex */
+    AlignedVector extras; /* VertexExtra */
+    AlignedVector indices; /* GLuint */
+} DisplayList;
+
+GLboolean LIST_COMPILING = GL_FALSE;
+
+static AlignedVector LISTS; /* DisplayList*, indexed by name */
+static DisplayList* COMPILING_LIST = NULL;
+static GLuint COMPILING_INDEX = 0;
+static GLenum COMPILING_MODE = GL_COMPILE;
+static GLuint LIST_BASE = 0;
+static GLuint LIST_DEPTH = 0;
+
+void _glInitDisplayLists() {
+    aligned_vector_init(&LISTS, sizeof(DisplayList*));
+
+    /* Zero is never a list */
+    DisplayList* none = NULL;
+    aligned_vector_push_back(&LISTS, &none, 1);
+}
+
+static DisplayList* _glCreateList() {
+    DisplayList* list = (DisplayList*) malloc(sizeof(DisplayList));
+
+    aligned_vector_init(&list->commands, sizeof(ListCommand));
+    aligned_vector_init(&list->vertices, sizeof(Vertex));
+    aligned_vector_init(&list->extras, sizeof(VertexExtra));
+    aligned_vector_init(&list->indices, sizeof(GLuint));
+
+    return list;
+}
+
+static void _glDestroyList(DisplayList* list) {
+    if(!list) {
+        return;
+    }
+
+    aligned_vector_cleanup(&list->commands);
+    aligned_vector_cleanup(&list->vertices);
+    aligned_vector_cleanup(&list->extras);
+    aligned_vector_cleanup(&list->indices);
+    free(list);
+}
+
+static DisplayList** _glListSlot(GLuint list) {
+    return (list && list < LISTS.size) ? (DisplayList**) aligned_vector_at(&LISTS, list) : NULL;
+}
+
+/* Makes sure there's a slot for the list name, returning it */
+static DisplayList** _glReserveListSlot(GLuint list) {
+    if(list >= LISTS.size) {
+        const GLuint previous = LISTS.size;
+        aligned_vector_resize(&LISTS, list + 1);
+        memset(aligned_vector_at(&LISTS, previous), 0, sizeof(DisplayList*) * (LISTS.size - previous));
+    }
+
+    return (DisplayList**) aligned_vector_at(&LISTS, list);
+}
+
+GLboolean _glListRecord(ListCommandType type, const void* args, GLuint size) {
+    gl_assert(size <= sizeof(((ListCommand*) 0)->args));
+
+    ListCommand* command = (ListCommand*) aligned_vector_extend(&COMPILING_LIST->commands, 1);
+    command->type = type;
+
+    if(size) {
+        memcpy(&command->args, args, size);
+    }
+
+    return COMPILING_MODE == GL_COMPILE_AND_EXECUTE;
+}
+
+static GLuint _glListIndex(const GLvoid* indices, GLenum type, GLuint i) {
+    switch(type) {
+        case GL_UNSIGNED_BYTE:
+            return ((const GLubyte*) indices)[i];
+        case GL_UNSIGNED_SHORT:
+            return ((const GLushort*) indices)[i];
+        default:
+            return ((const GLuint*) indices)[i];
+    }
+}
+
+GLboolean _glListRecordDraw(GLenum mode, GLsizei first, GLuint count, GLenum type, const GLvoid* indices) {
+    GLuint* enabled = _glGetEnabledAttributes();
+
+    if(!count || !(*enabled & VERTEX_ENABLED_FLAG)) {
+        return COMPILING_MODE == GL_COMPILE_AND_EXECUTE;
+    }
+
+    DisplayList* list = COMPILING_LIST;
+
+    GLuint lo = first;
+    GLuint range = count;
+
+    if(indices) {
+        GLuint hi = 0;
+        lo = ~0u;
+
+        for(GLuint i = 0; i < count; ++i) {
+            const GLuint idx = _glListIndex(indices, type, i);
+            lo = MIN(lo, idx);
+            hi = MAX(hi, idx);
+        }
+
+        range = (hi - lo) + 1;
+    }
+
+    const GLuint vertex_start = list->vertices.size;
+    aligned_vector_extend(&list->vertices, range);
+    aligned_vector_extend(&list->extras, range);
+
+    _glConvertVertices(
+        lo, range,
+        aligned_vector_at(&list->vertices, vertex_start),
+        aligned_vector_at(&list->extras, vertex_start)
+    );
+
+    const GLuint index_start = list->indices.size;
+
+    if(indices) {
+        GLuint* it = (GLuint*) aligned_vector_extend(&list->indices, count);
+
+        for(GLuint i = 0; i < count; ++i) {
+            *it++ = _glListIndex(indices, type, i) - lo;
+        }
+    }
+
+    const GLuint args[] = {mode, vertex_start, range, index_start, (indices) ? count : 0};
+    return _glListRecord(LIST_CMD_DRAW, args, sizeof(args));
+}
+
+static void _glExecuteList(GLuint name);
+
+static void _glExecuteCommand(const DisplayList* list, const ListCommand* command) {
+    const GLuint* u = command->args.u;
+    const GLfloat* f = command->args.f;
+
+    switch(command->type) {
+        case LIST_CMD_DRAW: {
+            ConvertedVertices source;
+            source.vertices = (const Vertex*) aligned_vector_at(&list->vertices, u[1]);
+            source.extras = (const VertexExtra*) aligned_vector_at(&list->extras, u[1]);
+            source.count = u[2];
+
+            if(u[4]) {
+                _glDrawConvertedVertices(u[0], u[4], aligned_vector_at(&list->indices, u[3]), &source);
+            } else {
+                _glDrawConvertedVertices(u[0], u[2], NULL, &source);
+            }
+        } break;
+        case LIST_CMD_CALL_LIST:
+            _glExecuteList(u[0]);
+        break;
+        case LIST_CMD_MATRIX_MODE:
+            glMatrixMode(u[0]);
+        break;
+        case LIST_CMD_LOAD_IDENTITY:
+            glLoadIdentity();
+        break;
+        case LIST_CMD_LOAD_MATRIX:
+            glLoadMatrixf(f);
+        break;
+        case LIST_CMD_MULT_MATRIX:
+            glMultMatrixf(f);
+        break;
+        case LIST_CMD_PUSH_MATRIX:
+            glPushMatrix();
+        break;
+        case LIST_CMD_POP_MATRIX:
+            glPopMatrix();
+        break;
+        case LIST_CMD_TRANSLATE:
+            glTranslatef(f[0], f[1], f[2]);
+        break;
+        case LIST_CMD_ROTATE:
+            glRotatef(f[0], f[1], f[2], f[3]);
+        break;
+        case LIST_CMD_SCALE:
+            glScalef(f[0], f[1], f[2]);
+        break;
+        case LIST_CMD_ACTIVE_TEXTURE:
+            glActiveTextureARB(u[0]);
+        break;
+        case LIST_CMD_BIND_TEXTURE:
+            glBindTexture(u[0], u[1]);
+        break;
+        case LIST_CMD_ENABLE:
+            glEnable(u[0]);
+        break;
+        case LIST_CMD_DISABLE:
+            glDisable(u[0]);
+        break;
+        case LIST_CMD_BLEND_FUNC:
+            glBlendFunc(u[0], u[1]);
+        break;
+        case LIST_CMD_DEPTH_FUNC:
+            glDepthFunc(u[0]);
+        break;
+        case LIST_CMD_DEPTH_MASK:
+            glDepthMask((GLboolean) u[0]);
+        break;
+        case LIST_CMD_SHADE_MODEL:
+            glShadeModel(u[0]);
+        break;
+        case LIST_CMD_LIGHT:
+            glLightfv((GLenum) f[0], (GLenum) f[1], f + 2);
+        break;
+        case LIST_CMD_LIGHT_MODEL:
+            glLightModelfv((GLenum) f[0], f + 1);
+        break;
+        case LIST_CMD_LIGHT_MODEL_INT:
+            glLightModeliv(u[0], (const GLint*) u + 1);
+        break;
+        case LIST_CMD_MATERIAL:
+            glMaterialfv((GLenum) f[0], (GLenum) f[1], f + 2);
+        break;
+        case LIST_CMD_COLOR_MATERIAL:
+            glColorMaterial(u[0], u[1]);
+        break;
+        case LIST_CMD_FOG:
+            glFogfv((GLenum) f[0], f + 1);
+        break;
+        case LIST_CMD_ALPHA_FUNC:
+            glAlphaFunc((GLenum) f[0], f[1]);
+        break;
+        case LIST_CMD_TEX_PARAMETER:
+            glTexParameteri(u[0], u[1], (GLint) u[2]);
+        break;
+        case LIST_CMD_TEX_ENV:
+            glTexEnvi(u[0], u[1], (GLint) u[2]);
+        break;
+        case LIST_CMD_CULL_FACE:
+            glCullFace(u[0]);
+        break;
+        case LIST_CMD_FRONT_FACE:
+            glFrontFace(u[0]);
+        break;
+        case LIST_CMD_POLYGON_OFFSET:
+            glPolygonOffset(f[0], f[1]);
+        break;
+        case LIST_CMD_COLOR_MASK:
+            glColorMask((GLboolean) u[0], (GLboolean) u[1], (GLboolean) u[2], (GLboolean) u[3]);
+        break;
+        case LIST_CMD_SCISSOR:
+            glScissor((GLint) u[0], (GLint) u[1], (GLsizei) u[2], (GLsizei) u[3]);
+        break;
+    }
+}
+
+static void _glExecuteList(GLuint name) {
+    DisplayList** slot = _glListSlot(name);
+
+    if(!slot || !*slot || LIST_DEPTH >= MAX_GLDC_LIST_NESTING) {
+        return;
+    }
+
+    /* Nothing called from the list is recorded, even while compiling
+     * with GL_COMPILE_AND_EXECUTE */
+    const GLboolean compiling = LIST_COMPILING;
+    LIST_COMPILING = GL_FALSE;
+    ++LIST_DEPTH;
+
+    const DisplayList* list = *slot;
+
+    for(GLuint i = 0; i < list->commands.size; ++i) {
+        _glExecuteCommand(list, (const ListCommand*) aligned_vector_at(&list->commands, i));
+    }
+
+    --LIST_DEPTH;
+    LIST_COMPILING = compiling;
+}
+
+GLuint _glGetListIndex() {
+    return (COMPILING_LIST) ? COMPILING_INDEX : 0;
+}
+
+GLenum _glGetListMode() {
+    return (COMPILING_LIST) ? COMPILING_MODE : 0;
+}
+
+GLuint _glGetListBase() {
+    return LIST_BASE;
+}
+
+GLuint APIENTRY glGenLists(GLsizei range) {
+    TRACE();
+
+    if(!range) {
+        return 0;
+    }
+
+    /* Names are handed out from the end, so they're always contiguous */
+    const GLuint base = LISTS.size;
+    _glReserveListSlot(base + range - 1);
+
+    for(GLuint i = 0; i < range; ++i) {
+        *_glListSlot(base + i) = _glCreateList();
+    }
+
+    return base;
+}
+
+void APIENTRY glDeleteLists(GLuint list, GLsizei range) {
+    TRACE();
+
+    for(GLuint i = 0; i < range; ++i) {
+        DisplayList** slot = _glListSlot(list + i);
+
+        if(slot) {
+            _glDestroyList(*slot);
+            *slot = NULL;
+        }
+    }
+}
+
+GLboolean APIENTRY glIsList(GLuint list) {
+    DisplayList** slot = _glListSlot(list);
+    return (slot && *slot) ? GL_TRUE : GL_FALSE;
+}
+
+void APIENTRY glNewList(GLuint list, GLenum mode) {
+    TRACE();
+
+    if(!list) {
+        _glKosThrowError(GL_INVALID_VALUE, __func__);
+        return;
+    }
+
+    if(mode != GL_COMPILE && mode != GL_COMPILE_AND_EXECUTE) {
+        _glKosThrowError(GL_INVALID_ENUM, __func__);
+        return;
+    }
+
+    if(COMPILING_LIST || IMMEDIATE_MODE_ACTIVE) {
+        _glKosThrowError(GL_INVALID_OPERATION, __func__);
+        return;
+    }
+
+    /* The list being replaced stays callable until glEndList */
+    COMPILING_LIST = _glCreateList();
+    COMPILING_INDEX = list;
+    COMPILING_MODE = mode;
+    LIST_COMPILING = GL_TRUE;
+}
+
+void APIENTRY glEndList() {
+    TRACE();
+
+    if(!COMPILING_LIST || IMMEDIATE_MODE_ACTIVE) {
+        _glKosThrowError(GL_INVALID_OPERATION, __func__);
+        return;
+    }
+
+    DisplayList** slot = _glReserveListSlot(COMPILING_INDEX);
+    _glDestroyList(*slot);
+
+    aligned_vector_shrink_to_fit(&COMPILING_LIST->commands);
+    aligned_vector_shrink_to_fit(&COMPILING_LIST->vertices);
+    aligned_vector_shrink_to_fit(&COMPILING_LIST->extras);
+    aligned_vector_shrink_to_fit(&COMPILING_LIST->indices);
+
+    *slot = COMPILING_LIST;
+
+    COMPILING_LIST = NULL;
+    COMPILING_INDEX = 0;
+    LIST_COMPILING = GL_FALSE;
+}
+
+void APIENTRY glCallList(GLuint list) {
+    TRACE();
+
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_CALL_LIST, &list, sizeof(list))) {
+        return;
+    }
+
+    _glExecuteList(list);
+}
+
+void APIENTRY glCallLists(GLsizei n, GLenum type, const GLvoid* lists) {
+    TRACE();
+
+    for(GLsizei i = 0; i < n; ++i) {
+        GLuint list;
+
+        switch(type) {
+            case GL_BYTE:
+                list = ((const GLbyte*) lists)[i];
+            break;
+            case GL_UNSIGNED_BYTE:
+                list = ((const GLubyte*) lists)[i];
+            break;
+            case GL_SHORT:
+                list = ((const GLshort*) lists)[i];
+            break;
+            case GL_UNSIGNED_SHORT:
+                list = ((const GLushort*) lists)[i];
+            break;
+            case GL_INT:
+            case GL_UNSIGNED_INT:
+                list = ((const GLuint*) lists)[i];
+            break;
+            case GL_FLOAT:
+                list = (GLuint) ((const GLfloat*) lists)[i];
+            break;
+            default:
+                _glKosThrowError(GL_INVALID_ENUM, __func__);
+                return;
+        }
+
+        glCallList(LIST_BASE + list);
+    }
+}
+
+void APIENTRY glListBase(GLuint base) {
+    TRACE();
+
+    LIST_BASE = base;
+}
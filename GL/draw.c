@@ -31,26 +31,31 @@ void _glInitAttributePointers() {
     ATTRIB_POINTERS.vertex.stride = 0;
     ATTRIB_POINTERS.vertex.type = GL_FLOAT;
     ATTRIB_POINTERS.vertex.size = 4;
+    ATTRIB_POINTERS.vertex.buffer = NULL;
 
     ATTRIB_POINTERS.colour.ptr = NULL;
     ATTRIB_POINTERS.colour.stride = 0;
     ATTRIB_POINTERS.colour.type = GL_FLOAT;
     ATTRIB_POINTERS.colour.size = 4;
+    ATTRIB_POINTERS.colour.buffer = NULL;
 
     ATTRIB_POINTERS.uv.ptr = NULL;
     ATTRIB_POINTERS.uv.stride = 0;
     ATTRIB_POINTERS.uv.type = GL_FLOAT;
     ATTRIB_POINTERS.uv.size = 4;
+    ATTRIB_POINTERS.uv.buffer = NULL;
 
     ATTRIB_POINTERS.st.ptr = NULL;
     ATTRIB_POINTERS.st.stride = 0;
     ATTRIB_POINTERS.st.type = GL_FLOAT;
     ATTRIB_POINTERS.st.size = 4;
+    ATTRIB_POINTERS.st.buffer = NULL;
 
     ATTRIB_POINTERS.normal.ptr = NULL;
     ATTRIB_POINTERS.normal.stride = 0;
     ATTRIB_POINTERS.normal.type = GL_FLOAT;
     ATTRIB_POINTERS.normal.size = 3;
+    ATTRIB_POINTERS.normal.buffer = NULL;
 }
 
 GL_FORCE_INLINE GLsizei byte_size(GLenum type) {
@@ -68,6 +73,15 @@ GL_FORCE_INLINE GLsizei byte_size(GLenum type) {
     }
 }
 
+GL_FORCE_INLINE GLboolean _glComparePointers(AttribPointer* p, GLint size, GLenum type, GLsizei stride, const GLvoid* pointer, BufferObject* buffer) {
+    return (p->size == size && p->type == type && p->stride == stride && p->ptr == pointer && p->buffer == buffer);
+}
+
+/* With a buffer bound to GL_ARRAY_BUFFER_ARB the pointer is an offset into it */
+GL_FORCE_INLINE const GLvoid* _glAttribAddress(const BufferObject* buffer, const GLvoid* pointer) {
+    return (buffer) ? buffer->data + (uintptr_t) pointer : pointer;
+}
+
 typedef void (*FloatParseFunc)(GLfloat* out, const GLubyte* in);
 typedef void (*ByteParseFunc)(GLubyte* out, const GLubyte* in);
 typedef void (*PolyBuildFunc)(Vertex* first, Vertex* previous, Vertex* vertex, Vertex* next, const GLsizei i);
@@ -325,7 +339,7 @@ static inline GLuint _parseUIntIndex(const GLubyte* in) {
 }
 
 static inline GLuint _parseUShortIndex(const GLubyte* in) {
-    return *((GLshort*) in);
+    return *((GLushort*) in);
 }
 
 
@@ -584,12 +598,9 @@ static void _readPositionData(ReadDiffuseFunc func, const GLuint first, const GL
     const GLsizei vstride = ATTRIB_POINTERS.vertex.stride;
     const GLubyte* vptr = ((GLubyte*) ATTRIB_POINTERS.vertex.ptr + (first * vstride));
 
-    float pos[3];
-    float w = 0.0f;
-
     ITERATE(count) {
         PREFETCH(vptr + vstride);
-        func(vptr, (GLubyte*) pos);
+        func(vptr, (GLubyte*) it->xyz);
         it->flags = GPU_CMD_VERTEX;
 
         vptr += vstride;
@@ -855,6 +866,8 @@ static void generateArrays(SubmissionTarget* target, const GLsizei first, const
     _readSTData(stfunc, first, count, ve);
 }
 
+static void genPrimitives(Vertex* it, const GLenum mode, const GLuint count);
+
 static void generate(SubmissionTarget* target, const GLenum mode, const GLsizei first, const GLuint count,
         const GLubyte* indices, const GLenum type) {
     /* Read from the client buffers and generate an array of ClipVertices */
@@ -883,8 +896,10 @@ static void generate(SubmissionTarget* target, const GLenum mode, const GLsizei
         }
     }
 
-    Vertex* it = _glSubmissionTargetStart(target);
-    // Drawing arrays
+    genPrimitives(_glSubmissionTargetStart(target), mode, count);
+}
+
+static void genPrimitives(Vertex* it, const GLenum mode, const GLuint count) {
     switch(mode) {
     case GL_TRIANGLES:
         genTriangles(it, count);
@@ -945,7 +960,7 @@ static void mat_transform_normal3(const float* xyz, const float* xyzOut, const u
     }
 }
 
-static void light(SubmissionTarget* target) {
+static void light(Vertex* vertex, VertexExtra* extra, const uint32_t count) {
 
     static AlignedVector* eye_space_data = NULL;
 
@@ -954,18 +969,363 @@ static void light(SubmissionTarget* target) {
         aligned_vector_init(eye_space_data, sizeof(EyeSpaceData));
     }
 
-    aligned_vector_resize(eye_space_data, target->count);
+    aligned_vector_resize(eye_space_data, count);
 
     /* Perform lighting calculations and manipulate the colour */
-    Vertex* vertex = _glSubmissionTargetStart(target);
-    VertexExtra* extra = aligned_vector_at(target->extras, 0);
     EyeSpaceData* eye_space = (EyeSpaceData*) eye_space_data->data;
 
     _glMatrixLoadNormal();
-    mat_transform_normal3(extra->nxyz, eye_space->n, target->count, sizeof(VertexExtra), sizeof(EyeSpaceData));
+    mat_transform_normal3(extra->nxyz, eye_space->n, count, sizeof(VertexExtra), sizeof(EyeSpaceData));
 
     EyeSpaceData* ES = aligned_vector_at(eye_space_data, 0);
-    _glPerformLighting(vertex, ES, target->count);
+    _glPerformLighting(vertex, ES, count);
+}
+
+/* Takes vertices from object space to clip space, lighting them on the way if
+ * needed. The modelview (or modelview-projection) matrix must be loaded */
+static void transformAndLight(Vertex* vertices, VertexExtra* extras, const GLuint count) {
+    TransformVertices(vertices, count);
+
+    if(_glIsLightingEnabled()) {
+        light(vertices, extras, count);
+
+        _glMatrixLoadProjection();
+        TransformVertices(vertices, count);
+    }
+}
+
+GL_FORCE_INLINE GLuint _glAttribVertexCount(const BufferObject* buffer, const AttribPointer* p, const GLsizei bytes) {
+    const GLsizeiptrARB offset = (const GLubyte*) p->ptr - buffer->data;
+
+    if(!p->stride || offset < 0 || offset + bytes > buffer->size) {
+        return 0;
+    }
+
+    return ((buffer->size - offset - bytes) / p->stride) + 1;
+}
+
+void _glConvertVertices(const GLuint first, const GLuint count, Vertex* vertices, VertexExtra* extras) {
+    _readPositionData(calcReadPositionFunc(), first, count, vertices);
+    _readDiffuseData(calcReadDiffuseFunc(), first, count, vertices);
+    _readUVData(calcReadUVFunc(), first, count, vertices);
+    _readNormalData(calcReadNormalFunc(), first, count, extras);
+    _readSTData(calcReadSTFunc(), first, count, extras);
+}
+
+static const ConvertedVertices* _glBufferConvertedVertices(const BufferObject* buffer) {
+    static ConvertedVertices converted;
+
+    converted.vertices = aligned_vector_at(&buffer->converted_vertices, 0);
+    converted.extras = aligned_vector_at(&buffer->converted_extras, 0);
+    converted.count = buffer->converted_vertices.size;
+    return &converted;
+}
+
+/* Returns the vertices of the GL_STATIC_DRAW_ARB buffer every enabled
+ * attribute is read from, converted for the current attribute layout, or NULL
+ * if the attributes don't all come from one. The conversion is only redone
+ * when the buffer or the layout changes. */
+static const ConvertedVertices* _glStaticVertexSource() {
+    BufferObject* buffer = ATTRIB_POINTERS.vertex.buffer;
+
+    if(!buffer || !buffer->data || buffer->usage != GL_STATIC_DRAW_ARB) {
+        return NULL;
+    }
+
+    AttribPointer* pointers[] = {
+        &ATTRIB_POINTERS.vertex,
+        &ATTRIB_POINTERS.colour,
+        &ATTRIB_POINTERS.uv,
+        &ATTRIB_POINTERS.st,
+        &ATTRIB_POINTERS.normal
+    };
+
+    AttribPointer* converted[] = {
+        &buffer->converted_layout.vertex,
+        &buffer->converted_layout.colour,
+        &buffer->converted_layout.uv,
+        &buffer->converted_layout.st,
+        &buffer->converted_layout.normal
+    };
+
+    const GLuint flags[] = {
+        VERTEX_ENABLED_FLAG,
+        DIFFUSE_ENABLED_FLAG,
+        UV_ENABLED_FLAG,
+        ST_ENABLED_FLAG,
+        NORMAL_ENABLED_FLAG
+    };
+
+    const GLboolean normalized = _glIsNormalizeEnabled();
+
+    GLboolean valid = buffer->converted_valid &&
+        buffer->converted_attributes == ENABLED_VERTEX_ATTRIBUTES &&
+        buffer->converted_normalized == normalized;
+
+    for(GLuint i = 0; i < 5; ++i) {
+        if(!(ENABLED_VERTEX_ATTRIBUTES & flags[i])) {
+            continue;
+        }
+
+        const AttribPointer* p = pointers[i];
+        if(p->buffer != buffer) {
+            return NULL;
+        }
+
+        valid = valid && _glComparePointers(converted[i], p->size, p->type, p->stride, p->ptr, buffer);
+    }
+
+    if(valid) {
+        return _glBufferConvertedVertices(buffer);
+    }
+
+    /* Convert as many vertices as every enabled attribute has */
+    GLuint count = ~0u;
+    for(GLuint i = 0; i < 5; ++i) {
+        if(!(ENABLED_VERTEX_ATTRIBUTES & flags[i])) {
+            continue;
+        }
+
+        const AttribPointer* p = pointers[i];
+        const GLsizei size = (p == &ATTRIB_POINTERS.colour) ? diffusePointerSize() : (GLsizei) p->size;
+        count = MIN(count, _glAttribVertexCount(buffer, p, size * byte_size(p->type)));
+
+        *converted[i] = *p;
+    }
+
+    if(!count) {
+        return NULL;
+    }
+
+    aligned_vector_resize(&buffer->converted_vertices, count);
+    aligned_vector_resize(&buffer->converted_extras, count);
+
+    _glConvertVertices(
+        0, count,
+        aligned_vector_at(&buffer->converted_vertices, 0),
+        aligned_vector_at(&buffer->converted_extras, 0)
+    );
+
+    buffer->converted_attributes = ENABLED_VERTEX_ATTRIBUTES;
+    buffer->converted_normalized = normalized;
+    buffer->converted_valid = GL_TRUE;
+
+    return _glBufferConvertedVertices(buffer);
+}
+
+/* Reads count vertices starting at first, and their normals if extras isn't
+ * NULL. Vertices which were already converted are simply copied */
+static void fetchVertices(const ConvertedVertices* source, const GLuint first, const GLuint count, Vertex* vertices, VertexExtra* extras) {
+    if(source && first + count <= source->count) {
+        FASTCPY(vertices, source->vertices + first, sizeof(Vertex) * count);
+
+        if(extras) {
+            FASTCPY(extras, source->extras + first, sizeof(VertexExtra) * count);
+        }
+
+        return;
+    }
+
+    _readPositionData(calcReadPositionFunc(), first, count, vertices);
+    _readDiffuseData(calcReadDiffuseFunc(), first, count, vertices);
+    _readUVData(calcReadUVFunc(), first, count, vertices);
+
+    if(extras) {
+        _readNormalData(calcReadNormalFunc(), first, count, extras);
+    }
+}
+
+/* Converted arrays are copied into the output and transformed */
+static void generateArraysConverted(SubmissionTarget* target, const ConvertedVertices* source, const GLenum mode, const GLsizei first, const GLuint count) {
+    Vertex* start = _glSubmissionTargetStart(target);
+    VertexExtra* ve = (_glIsLightingEnabled()) ? aligned_vector_at(target->extras, 0) : NULL;
+
+    fetchVertices(source, first, count, start, ve);
+    transformAndLight(start, ve, count);
+    genPrimitives(start, mode, count);
+}
+
+/* EXT_compiled_vertex_array. The locked range is read the first time it's
+ * drawn and a transformed (and lit) copy of it is kept, along with the
+ * matrices and lighting generation it was transformed with. Draws using the
+ * attributes the arrays were locked with copy from there, and the copy is
+ * only redone when the matrices or the lighting change. */
+static GLint LOCKED_FIRST = 0;
+static GLsizei LOCKED_COUNT = 0;
+
+static struct {
+    AttribPointerList pointers;
+    GLuint attributes;
+    GLboolean converted;
+    GLboolean normalized;
+    GLboolean transformed;
+    GLuint lighting_generation;
+    Matrix4x4 modelview;
+    Matrix4x4 projection;
+} LOCKED_STATE;
+
+static AlignedVector LOCKED_VERTICES;
+static AlignedVector LOCKED_EXTRAS;
+static AlignedVector LOCKED_TRANSFORMED;
+
+GLint _glGetLockedFirst() {
+    return LOCKED_FIRST;
+}
+
+GLsizei _glGetLockedCount() {
+    return LOCKED_COUNT;
+}
+
+/* Returns the locked range transformed for the current matrices and
+ * lighting, or NULL if nothing is locked or the attributes aren't the ones
+ * which were. This loads matrices, so must happen before the draw does */
+static const Vertex* _glLockedVertices(const ConvertedVertices* source) {
+    if(!LOCKED_COUNT) {
+        return NULL;
+    }
+
+    if(ENABLED_VERTEX_ATTRIBUTES != LOCKED_STATE.attributes ||
+        memcmp(&ATTRIB_POINTERS, &LOCKED_STATE.pointers, sizeof(AttribPointerList)) != 0) {
+        return NULL;
+    }
+
+    const GLboolean normalized = _glIsNormalizeEnabled();
+
+    if(!LOCKED_STATE.converted || LOCKED_STATE.normalized != normalized) {
+        fetchVertices(
+            source, LOCKED_FIRST, LOCKED_COUNT,
+            aligned_vector_at(&LOCKED_VERTICES, 0),
+            aligned_vector_at(&LOCKED_EXTRAS, 0)
+        );
+
+        LOCKED_STATE.converted = GL_TRUE;
+        LOCKED_STATE.normalized = normalized;
+        LOCKED_STATE.transformed = GL_FALSE;
+    }
+
+    const GLboolean lighting = _glIsLightingEnabled();
+    const GLuint lighting_generation = _glLightingGeneration();
+
+    const GLboolean valid = LOCKED_STATE.transformed &&
+        LOCKED_STATE.lighting_generation == lighting_generation &&
+        memcmp(LOCKED_STATE.modelview, _glGetModelViewMatrix(), sizeof(Matrix4x4)) == 0 &&
+        memcmp(LOCKED_STATE.projection, _glGetProjectionMatrix(), sizeof(Matrix4x4)) == 0;
+
+    Vertex* transformed = aligned_vector_at(&LOCKED_TRANSFORMED, 0);
+
+    if(valid) {
+        return transformed;
+    }
+
+    FASTCPY(transformed, aligned_vector_at(&LOCKED_VERTICES, 0), sizeof(Vertex) * LOCKED_COUNT);
+
+    if(lighting) {
+        _glMatrixLoadModelView();
+    } else {
+        _glMatrixLoadModelViewProjection();
+    }
+
+    transformAndLight(transformed, aligned_vector_at(&LOCKED_EXTRAS, 0), LOCKED_COUNT);
+
+    memcpy(LOCKED_STATE.modelview, _glGetModelViewMatrix(), sizeof(Matrix4x4));
+    memcpy(LOCKED_STATE.projection, _glGetProjectionMatrix(), sizeof(Matrix4x4));
+
+    LOCKED_STATE.lighting_generation = lighting_generation;
+    LOCKED_STATE.transformed = GL_TRUE;
+
+    return transformed;
+}
+
+GL_FORCE_INLINE GLboolean _glLockedRangeContains(const GLuint lo, const GLuint hi) {
+    return lo >= (GLuint) LOCKED_FIRST && hi < (GLuint) (LOCKED_FIRST + LOCKED_COUNT);
+}
+
+static GLboolean generateArraysLocked(SubmissionTarget* target, const Vertex* locked, const GLenum mode, const GLsizei first, const GLuint count) {
+    if(!_glLockedRangeContains(first, first + count - 1)) {
+        return GL_FALSE;
+    }
+
+    Vertex* start = _glSubmissionTargetStart(target);
+
+    FASTCPY(start, locked + (first - LOCKED_FIRST), sizeof(Vertex) * count);
+    genPrimitives(start, mode, count);
+    return GL_TRUE;
+}
+
+/* Indexed meshes share most of their vertices between several triangles. Rather
+ * than transforming (and lighting) a vertex each time it's indexed, the range
+ * of indices used by the draw is read and transformed once into a scratch
+ * array and the output is gathered from there.
+ *
+ * When the indices are too spread out for that to be worth it, vertices
+ * which were already converted are gathered before being transformed. If
+ * they're all in the locked range they're gathered already transformed.
+ * Otherwise GL_FALSE is returned and nothing has been written. */
+static AlignedVector INDEXED_VERTICES;
+static AlignedVector INDEXED_EXTRAS;
+
+static GLboolean generateElementsShared(
+        SubmissionTarget* target, const ConvertedVertices* source, const Vertex* locked, const GLenum mode, const GLsizei first,
+        const GLuint count, const GLubyte* indices, const GLenum type) {
+
+    const GLsizei istride = byte_size(type);
+    const IndexParseFunc IndexFunc = _calcParseIndexFunc(type);
+    const GLubyte* iptr = indices + (first * istride);
+
+    GLuint lo = ~0u;
+    GLuint hi = 0;
+
+    for(GLuint i = 0; i < count; ++i) {
+        const GLuint idx = IndexFunc(iptr + (i * istride));
+        lo = MIN(lo, idx);
+        hi = MAX(hi, idx);
+    }
+
+    const GLboolean lighting = _glIsLightingEnabled();
+    const GLuint range = (hi - lo) + 1;
+
+    Vertex* it = _glSubmissionTargetStart(target);
+
+    if(locked && _glLockedRangeContains(lo, hi)) {
+        for(GLuint i = 0; i < count; ++i) {
+            it[i] = locked[IndexFunc(iptr + (i * istride)) - LOCKED_FIRST];
+        }
+    } else if(range > count) {
+        if(!source || hi >= source->count) {
+            return GL_FALSE;
+        }
+
+        const Vertex* vertices = source->vertices;
+        const VertexExtra* extras = source->extras;
+        VertexExtra* ve = aligned_vector_at(target->extras, 0);
+
+        for(GLuint i = 0; i < count; ++i) {
+            const GLuint idx = IndexFunc(iptr + (i * istride));
+            it[i] = vertices[idx];
+
+            if(lighting) {
+                ve[i] = extras[idx];
+            }
+        }
+
+        transformAndLight(it, ve, count);
+    } else {
+        aligned_vector_resize(&INDEXED_VERTICES, range);
+        aligned_vector_resize(&INDEXED_EXTRAS, range);
+
+        Vertex* cache = aligned_vector_at(&INDEXED_VERTICES, 0);
+        VertexExtra* ve = (lighting) ? aligned_vector_at(&INDEXED_EXTRAS, 0) : NULL;
+
+        fetchVertices(source, lo, range, cache, ve);
+        transformAndLight(cache, ve, range);
+
+        for(GLuint i = 0; i < count; ++i) {
+            it[i] = cache[IndexFunc(iptr + (i * istride)) - lo];
+        }
+    }
+
+    genPrimitives(it, mode, count);
+    return GL_TRUE;
 }
 
 GL_FORCE_INLINE void divide(SubmissionTarget* target) {
@@ -1166,17 +1526,33 @@ void _glInitSubmissionTarget() {
 
     aligned_vector_init(&VERTEX_EXTRAS, sizeof(VertexExtra));
     target->extras = &VERTEX_EXTRAS;
+
+    aligned_vector_init(&INDEXED_VERTICES, sizeof(Vertex));
+    aligned_vector_init(&INDEXED_EXTRAS, sizeof(VertexExtra));
+
+    aligned_vector_init(&LOCKED_VERTICES, sizeof(Vertex));
+    aligned_vector_init(&LOCKED_EXTRAS, sizeof(VertexExtra));
+    aligned_vector_init(&LOCKED_TRANSFORMED, sizeof(Vertex));
 }
 
 
-GL_FORCE_INLINE void submitVertices(GLenum mode, GLsizei first, GLuint count, GLenum type, const GLvoid* indices) {
+/* Every strip but the last is ended where it finishes, genTriangleStrip
+ * ends the last */
+static void genStripEnds(Vertex* output, const TriangleStrips* strips) {
+    for(GLuint i = 0; i < strips->end_count; ++i) {
+        output[strips->ends[i]].flags = GPU_CMD_VERTEX_EOL;
+    }
+}
+
+GL_FORCE_INLINE void submitVertices(GLenum mode, GLsizei first, GLuint count, GLenum type, const GLvoid* indices,
+        const ConvertedVertices* source, const Vertex* locked, const TriangleStrips* strips) {
     SubmissionTarget* const target = &SUBMISSION_TARGET;
     AlignedVector* const extras = target->extras;
 
     TRACE();
 
     /* Do nothing if vertices aren't enabled */
-    if(!(ENABLED_VERTEX_ATTRIBUTES & VERTEX_ENABLED_FLAG)) {
+    if(!source && !(ENABLED_VERTEX_ATTRIBUTES & VERTEX_ENABLED_FLAG)) {
         return;
     }
 
@@ -1185,6 +1561,15 @@ GL_FORCE_INLINE void submitVertices(GLenum mode, GLsizei first, GLuint count, GL
         return;
     }
 
+    /* Triangles which were joined into strips are drawn as those */
+    if(strips) {
+        mode = GL_TRIANGLE_STRIP;
+        first = 0;
+        count = strips->count;
+        type = GL_UNSIGNED_INT;
+        indices = strips->indices;
+    }
+
     /* Polygons are treated as triangle fans, the only time this would be a
      * problem is if we supported glPolygonMode(..., GL_LINE) but we don't.
      * We optimise the triangle and quad cases.
@@ -1210,13 +1595,13 @@ GL_FORCE_INLINE void submitVertices(GLenum mode, GLsizei first, GLuint count, GL
         return;
     }
 
-    GLboolean header_required = (target->output->vector.size == 0) || _glGPUStateIsDirty();
+    target->output = _glActivePolyList();
 
+    GLboolean header_required = (target->output->vector.size == 0) || _glGPUStateIsDirty();
 
     // We don't handle this any further, so just make sure we never pass it down */
     gl_assert(mode != GL_POLYGON);
 
-    target->output = _glActivePolyList();
     target->count = (mode == GL_TRIANGLE_FAN) ? ((count - 2) * 3) : count;
     target->header_offset = target->output->vector.size;
     target->start_offset = target->header_offset + (header_required);
@@ -1247,21 +1632,33 @@ GL_FORCE_INLINE void submitVertices(GLenum mode, GLsizei first, GLuint count, GL
         _glMatrixLoadModelViewProjection();
     }
 
-    /* If we're FAST_PATH_ENABLED, then this will do the transform for us */
-    generate(target, mode, first, count, (GLubyte*) indices, type);
+    if(indices && generateElementsShared(target, source, locked, mode, first, count, (GLubyte*) indices, type)) {
+        /* Already transformed and lit, once per unique vertex */
+    } else if(!indices && locked && generateArraysLocked(target, locked, mode, first, count)) {
+        /* Copied from the locked range */
+    } else if(!indices && source) {
+        generateArraysConverted(target, source, mode, first, count);
+    } else {
+        /* If we're FAST_PATH_ENABLED, then this will do the transform for us */
+        generate(target, mode, first, count, (GLubyte*) indices, type);
 
-    /* No fast path, then we have to do another iteration :( */
-    if(!FAST_PATH_ENABLED) {
-        /* Multiply by modelview */
-        transform(target);
-    }
+        /* No fast path, then we have to do another iteration :( */
+        if(!FAST_PATH_ENABLED) {
+            /* Multiply by modelview */
+            transform(target);
+        }
 
-    if(_glIsLightingEnabled()){
-        light(target);
+        if(_glIsLightingEnabled()){
+            light(_glSubmissionTargetStart(target), aligned_vector_at(extras, 0), target->count);
 
-        /* OK eye-space work done, now move into clip space */
-        _glMatrixLoadProjection();
-        transform(target);
+            /* OK eye-space work done, now move into clip space */
+            _glMatrixLoadProjection();
+            transform(target);
+        }
+    }
+
+    if(strips) {
+        genStripEnds(_glSubmissionTargetStart(target), strips);
     }
 
     // /*
@@ -1315,7 +1712,30 @@ void APIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvo
         return;
     }
 
-    submitVertices(mode, 0, count, type, indices);
+    /* With a buffer bound the indices are an offset into it */
+    BufferObject* elements = _glGetBoundBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB);
+    if(elements) {
+        if(!elements->data) {
+            _glKosThrowError(GL_INVALID_OPERATION, __func__);
+            return;
+        }
+
+        indices = elements->data + (uintptr_t) indices;
+    }
+
+    if(LIST_COMPILING && !_glListRecordDraw(mode, 0, count, type, indices)) {
+        return;
+    }
+
+    /* Flat shaded triangles take their colour from their last vertex, which
+     * strips would change */
+    const TriangleStrips* strips = NULL;
+    if(elements && mode == GL_TRIANGLES && _glIsStripifyEnabled() && _glGetShadeModel() == GL_SMOOTH) {
+        strips = _glBufferStrips(elements, indices, count, type);
+    }
+
+    const ConvertedVertices* source = _glStaticVertexSource();
+    submitVertices(mode, 0, count, type, indices, source, _glLockedVertices(source), strips);
 }
 
 void APIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count) {
@@ -1325,7 +1745,63 @@ void APIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count) {
         return;
     }
 
-    submitVertices(mode, first, count, GL_UNSIGNED_INT, NULL);
+    if(LIST_COMPILING && !_glListRecordDraw(mode, first, count, GL_UNSIGNED_INT, NULL)) {
+        return;
+    }
+
+    const ConvertedVertices* source = _glStaticVertexSource();
+    submitVertices(mode, first, count, GL_UNSIGNED_INT, NULL, source, _glLockedVertices(source), NULL);
+}
+
+void _glDrawConvertedVertices(GLenum mode, GLuint count, const GLuint* indices, const ConvertedVertices* source) {
+    submitVertices(mode, 0, count, GL_UNSIGNED_INT, indices, source, NULL, NULL);
+}
+
+void APIENTRY glLockArraysEXT(GLint first, GLsizei count) {
+    TRACE();
+
+    if(_glCheckImmediateModeInactive(__func__)) {
+        return;
+    }
+
+    if(first < 0 || count <= 0) {
+        _glKosThrowError(GL_INVALID_VALUE, __func__);
+        return;
+    }
+
+    if(LOCKED_COUNT) {
+        _glKosThrowError(GL_INVALID_OPERATION, __func__);
+        return;
+    }
+
+    LOCKED_FIRST = first;
+    LOCKED_COUNT = count;
+
+    LOCKED_STATE.pointers = ATTRIB_POINTERS;
+    LOCKED_STATE.attributes = ENABLED_VERTEX_ATTRIBUTES;
+    LOCKED_STATE.converted = GL_FALSE;
+    LOCKED_STATE.transformed = GL_FALSE;
+
+    /* Capacity is kept between locks, as they tend to be of similar sizes */
+    aligned_vector_resize(&LOCKED_VERTICES, count);
+    aligned_vector_resize(&LOCKED_EXTRAS, count);
+    aligned_vector_resize(&LOCKED_TRANSFORMED, count);
+}
+
+void APIENTRY glUnlockArraysEXT() {
+    TRACE();
+
+    if(_glCheckImmediateModeInactive(__func__)) {
+        return;
+    }
+
+    if(!LOCKED_COUNT) {
+        _glKosThrowError(GL_INVALID_OPERATION, __func__);
+        return;
+    }
+
+    LOCKED_FIRST = 0;
+    LOCKED_COUNT = 0;
 }
 
 void APIENTRY glEnableClientState(GLenum cap) {
@@ -1397,10 +1873,6 @@ void APIENTRY glClientActiveTextureARB(GLenum texture) {
     ACTIVE_CLIENT_TEXTURE = (texture == GL_TEXTURE1_ARB) ? 1 : 0;
 }
 
-GL_FORCE_INLINE GLboolean _glComparePointers(AttribPointer* p, GLint size, GLenum type, GLsizei stride, const GLvoid* pointer) {
-    return (p->size == size && p->type == type && p->stride == stride && p->ptr == pointer);
-}
-
 void APIENTRY glTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid * pointer) {
     TRACE();
 
@@ -1409,16 +1881,20 @@ void APIENTRY glTexCoordPointer(GLint size, GLenum type, GLsizei stride, const G
         return;
     }
 
+    BufferObject* buffer = _glGetBoundBuffer(GL_ARRAY_BUFFER_ARB);
+    pointer = _glAttribAddress(buffer, pointer);
+
     stride = (stride) ? stride : size * byte_size(type);
 
     AttribPointer* tointer = (ACTIVE_CLIENT_TEXTURE == 0) ? &ATTRIB_POINTERS.uv : &ATTRIB_POINTERS.st;
 
-    if(_glComparePointers(tointer, size, type, stride, pointer)) {
+    if(_glComparePointers(tointer, size, type, stride, pointer, buffer)) {
         // No Change
         return;
     }
 
     tointer->ptr = pointer;
+    tointer->buffer = buffer;
     tointer->stride = stride;
     tointer->type = type;
     tointer->size = size;
@@ -1434,14 +1910,18 @@ void APIENTRY glVertexPointer(GLint size, GLenum type,  GLsizei stride,  const G
         return;
     }
 
+    BufferObject* buffer = _glGetBoundBuffer(GL_ARRAY_BUFFER_ARB);
+    pointer = _glAttribAddress(buffer, pointer);
+
     stride = (stride) ? stride : (size * byte_size(ATTRIB_POINTERS.vertex.type));
 
-    if(_glComparePointers(&ATTRIB_POINTERS.vertex, size, type, stride, pointer)) {
+    if(_glComparePointers(&ATTRIB_POINTERS.vertex, size, type, stride, pointer, buffer)) {
         // No Change
         return;
     }
 
     ATTRIB_POINTERS.vertex.ptr = pointer;
+    ATTRIB_POINTERS.vertex.buffer = buffer;
     ATTRIB_POINTERS.vertex.stride = stride;
     ATTRIB_POINTERS.vertex.type = type;
     ATTRIB_POINTERS.vertex.size = size;
@@ -1457,14 +1937,18 @@ void APIENTRY glColorPointer(GLint size,  GLenum type,  GLsizei stride,  const G
         return;
     }
 
+    BufferObject* buffer = _glGetBoundBuffer(GL_ARRAY_BUFFER_ARB);
+    pointer = _glAttribAddress(buffer, pointer);
+
     stride = (stride) ? stride : ((size == GL_BGRA) ? 4 : size) * byte_size(type);
 
-    if(_glComparePointers(&ATTRIB_POINTERS.colour, size, type, stride, pointer)) {
+    if(_glComparePointers(&ATTRIB_POINTERS.colour, size, type, stride, pointer, buffer)) {
         // No Change
         return;
     }
 
     ATTRIB_POINTERS.colour.ptr = pointer;
+    ATTRIB_POINTERS.colour.buffer = buffer;
     ATTRIB_POINTERS.colour.type = type;
     ATTRIB_POINTERS.colour.size = size;
     ATTRIB_POINTERS.colour.stride = stride;
@@ -1490,14 +1974,18 @@ void APIENTRY glNormalPointer(GLenum type,  GLsizei stride,  const GLvoid * poin
         return;
     }
 
+    BufferObject* buffer = _glGetBoundBuffer(GL_ARRAY_BUFFER_ARB);
+    pointer = _glAttribAddress(buffer, pointer);
+
     stride = (stride) ? stride : ATTRIB_POINTERS.normal.size * byte_size(type);
 
-    if(_glComparePointers(&ATTRIB_POINTERS.normal, 3, type, stride, pointer)) {
+    if(_glComparePointers(&ATTRIB_POINTERS.normal, 3, type, stride, pointer, buffer)) {
         // No Change
         return;
     }
 
     ATTRIB_POINTERS.normal.ptr = pointer;
+    ATTRIB_POINTERS.normal.buffer = buffer;
     ATTRIB_POINTERS.normal.size = (type == GL_UNSIGNED_INT_2_10_10_10_REV) ? 1 : 3;
     ATTRIB_POINTERS.normal.stride = stride;
     ATTRIB_POINTERS.normal.type = type;
@@ -6,6 +6,12 @@ PolyList OP_LIST;
 PolyList PT_LIST;
 PolyList TR_LIST;
 
+/* What's been submitted to the default framebuffer so far this frame, put
+ * aside while a framebuffer object is bound */
+static AlignedVector SAVED_OP_LIST;
+static AlignedVector SAVED_PT_LIST;
+static AlignedVector SAVED_TR_LIST;
+
 /**
  *  FAST_MODE will use invW for all Z coordinates sent to the
  *  GPU.
@@ -47,6 +53,11 @@ void APIENTRY glKosInitConfig(GLdcConfig* config) {
     config->initial_tr_capacity = 1024 * 3;
     config->initial_immediate_capacity = 1024 * 3;
     config->internal_palette_format = GL_RGBA8;
+
+    config->software_thread_count = 0;
+    config->software_texture_cache_size = 32 * 1024 * 1024;
+    config->software_resolution_divisor = 1;
+    config->software_target_frame_time = 16666;
 }
 
 void APIENTRY glKosInitEx(GLdcConfig* config) {
@@ -55,6 +66,10 @@ void APIENTRY glKosInitEx(GLdcConfig* config) {
     printf("\nWelcome to GLdc! Git revision: %s\n\n", GLDC_VERSION);
 
     InitGPU(config->autosort_enabled, config->fsaa_enabled);
+    GPUSetThreadCount(config->software_thread_count);
+    GPUSetTextureCacheSize(config->software_texture_cache_size);
+    GPUSetResolutionDivisor(config->software_resolution_divisor);
+    GPUSetTargetFrameTime(config->software_target_frame_time);
 
     AUTOSORT_ENABLED = config->autosort_enabled;
 
@@ -65,6 +80,8 @@ void APIENTRY glKosInitEx(GLdcConfig* config) {
     _glInitLights();
     _glInitImmediateMode(config->initial_immediate_capacity);
     _glInitFramebuffers();
+    _glInitBuffers();
+    _glInitDisplayLists();
 
     _glSetInternalPaletteFormat(config->internal_palette_format);
 
@@ -81,6 +98,10 @@ void APIENTRY glKosInitEx(GLdcConfig* config) {
     aligned_vector_reserve(&OP_LIST.vector, config->initial_op_capacity);
     aligned_vector_reserve(&PT_LIST.vector, config->initial_pt_capacity);
     aligned_vector_reserve(&TR_LIST.vector, config->initial_tr_capacity);
+
+    aligned_vector_init(&SAVED_OP_LIST, sizeof(Vertex));
+    aligned_vector_init(&SAVED_PT_LIST, sizeof(Vertex));
+    aligned_vector_init(&SAVED_TR_LIST, sizeof(Vertex));
 }
 
 void APIENTRY glKosInit() {
@@ -89,9 +110,7 @@ void APIENTRY glKosInit() {
     glKosInitEx(&config);
 }
 
-void APIENTRY glKosSwapBuffers() {
-    TRACE();
-
+static void RenderScene() {
     SceneBegin();
         if(OP_LIST.vector.size > 2) {
             SceneListBegin(GPU_LIST_OP_POLY);
@@ -116,5 +135,46 @@ void APIENTRY glKosSwapBuffers() {
     aligned_vector_clear(&PT_LIST.vector);
     aligned_vector_clear(&TR_LIST.vector);
 
+    _glApplyScissor(true);
+}
+
+void APIENTRY glKosSwapBuffers() {
+    TRACE();
+
+    RenderScene();
+}
+
+void _glRenderToTexture(TextureObject* texture) {
+    GLubyte* data = (texture->baseDataOffset == 0) ? texture->data : _glGetMipmapLocation(texture, 0);
+
+    if(data && GPUSetRenderTexture(data, texture->width, texture->height, texture->color)) {
+        RenderScene();
+        GPUSetRenderTexture(NULL, 0, 0, 0);
+    } else {
+        aligned_vector_clear(&OP_LIST.vector);
+        aligned_vector_clear(&PT_LIST.vector);
+        aligned_vector_clear(&TR_LIST.vector);
+
+        _glApplyScissor(true);
+    }
+}
+
+void _glSwapFramebufferLists() {
+    AlignedVector tmp;
+
+    tmp = OP_LIST.vector;
+    OP_LIST.vector = SAVED_OP_LIST;
+    SAVED_OP_LIST = tmp;
+
+    tmp = PT_LIST.vector;
+    PT_LIST.vector = SAVED_PT_LIST;
+    SAVED_PT_LIST = tmp;
+
+    tmp = TR_LIST.vector;
+    TR_LIST.vector = SAVED_TR_LIST;
+    SAVED_TR_LIST = tmp;
+
+    /* Whatever the lists ended with may not match the current state */
+    _glGPUStateMarkDirty();
     _glApplyScissor(true);
 }
\ No newline at end of file
@@ -20,6 +20,15 @@ static void updatePVRFog() {
 }
 
 void APIENTRY glFogf(GLenum pname,  GLfloat param) {
+    if(LIST_COMPILING && (
+        pname == GL_FOG_MODE || pname == GL_FOG_DENSITY ||
+        pname == GL_FOG_START || pname == GL_FOG_END)) {
+
+        if(!_glListRecord(LIST_CMD_FOG, (const GLfloat[]) {(GLfloat) pname, param}, sizeof(GLfloat) * 2)) {
+            return;
+        }
+    }
+
     switch(pname) {
     case GL_FOG_MODE: {
         FOG_MODE = (GLenum) param;
@@ -50,6 +59,11 @@ void APIENTRY glFogi(GLenum pname,  GLint param) {
 
 void APIENTRY glFogfv(GLenum pname,  const GLfloat* params) {
     if(pname == GL_FOG_COLOR) {
+        /* Anything else is passed on to glFogf, which records it */
+        if(LIST_COMPILING && !_glListRecord(LIST_CMD_FOG, (const GLfloat[]) {(GLfloat) pname, params[0], params[1], params[2], params[3]}, sizeof(GLfloat) * 5)) {
+            return;
+        }
+
         FOG_COLOR[0] = params[0];
         FOG_COLOR[1] = params[1];
         FOG_COLOR[2] = params[2];
@@ -62,11 +76,14 @@ void APIENTRY glFogfv(GLenum pname,  const GLfloat* params) {
 
 void APIENTRY glFogiv(GLenum pname,  const GLint* params) {
     if(pname == GL_FOG_COLOR) {
-        FOG_COLOR[0] = ((GLfloat) params[0]) / (GLfloat) INT_MAX;
-        FOG_COLOR[1] = ((GLfloat) params[1]) / (GLfloat) INT_MAX;
-        FOG_COLOR[2] = ((GLfloat) params[2]) / (GLfloat) INT_MAX;
-        FOG_COLOR[3] = ((GLfloat) params[3]) / (GLfloat) INT_MAX;
-        updatePVRFog();
+        const GLfloat colour[] = {
+            ((GLfloat) params[0]) / (GLfloat) INT_MAX,
+            ((GLfloat) params[1]) / (GLfloat) INT_MAX,
+            ((GLfloat) params[2]) / (GLfloat) INT_MAX,
+            ((GLfloat) params[3]) / (GLfloat) INT_MAX
+        };
+
+        glFogfv(pname, colour);
     } else {
         glFogi(pname, *params);
     }
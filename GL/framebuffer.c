@@ -6,9 +6,6 @@ typedef struct {
     GLuint index;
     GLuint texture_id;
     GLboolean is_complete;
-
-    /* FIXME: Add OP, TR and PT lists per framebuffer */
-
 } FrameBuffer;
 
 static FrameBuffer* ACTIVE_FRAMEBUFFER = NULL;
@@ -45,6 +42,30 @@ void APIENTRY glGenFramebuffersEXT(GLsizei n, GLuint* framebuffers) {
     }
 }
 
+/* Everything drawn while a framebuffer object is bound is collected in
+ * its own lists, the default framebuffer's are put aside until it's bound
+ * again. Moving off the framebuffer object renders what was drawn into
+ * its texture. */
+static void _glSetActiveFramebuffer(FrameBuffer* fb) {
+    if(fb == ACTIVE_FRAMEBUFFER) {
+        return;
+    }
+
+    if(ACTIVE_FRAMEBUFFER) {
+        TextureObject* texture = _glGetTextureObject(ACTIVE_FRAMEBUFFER->texture_id);
+
+        if(texture) {
+            _glRenderToTexture(texture);
+        }
+    }
+
+    if(!ACTIVE_FRAMEBUFFER || !fb) {
+        _glSwapFramebufferLists();
+    }
+
+    ACTIVE_FRAMEBUFFER = fb;
+}
+
 void APIENTRY glDeleteFramebuffersEXT(GLsizei n, const GLuint* framebuffers) {
     TRACE();
 
@@ -52,7 +73,7 @@ void APIENTRY glDeleteFramebuffersEXT(GLsizei n, const GLuint* framebuffers) {
         FrameBuffer* fb = (FrameBuffer*) named_array_get(&FRAMEBUFFERS, *framebuffers);
 
         if(fb == ACTIVE_FRAMEBUFFER) {
-            ACTIVE_FRAMEBUFFER = NULL;
+            _glSetActiveFramebuffer(NULL);
         }
 
         named_array_release(&FRAMEBUFFERS, *framebuffers++);
@@ -64,12 +85,9 @@ void APIENTRY glBindFramebufferEXT(GLenum target, GLuint framebuffer) {
     TRACE();
 
     if(framebuffer) {
-        ACTIVE_FRAMEBUFFER = (FrameBuffer*) named_array_get(&FRAMEBUFFERS, framebuffer);
+        _glSetActiveFramebuffer((FrameBuffer*) named_array_get(&FRAMEBUFFERS, framebuffer));
     } else {
-        ACTIVE_FRAMEBUFFER = NULL;
-
-        /* FIXME: This is where we need to submit the lists and then clear them. Binding zero means returning to the
-         * default framebuffer so we need to render a frame to the texture at that point */
+        _glSetActiveFramebuffer(NULL);
     }
 }
 
@@ -89,6 +107,13 @@ void APIENTRY glFramebufferTexture2DEXT(GLenum target, GLenum attachment, GLenum
     }
 
     ACTIVE_FRAMEBUFFER->texture_id = texture;
+
+    /* Textures are always kept twiddled, even ones which haven't been
+     * given any data yet, and that's how they're rendered into */
+    TextureObject* obj = _glGetTextureObject(texture);
+    if(obj) {
+        obj->color &= ~GPU_TXRFMT_NONTWIDDLED;
+    }
 }
 
 GL_FORCE_INLINE GLuint A1555(GLuint v) {
@@ -315,6 +340,7 @@ void APIENTRY glGenerateMipmapEXT(GLenum target) {
         GLuint thisHeight = (prevHeight > 1) ? prevHeight / 2 : 1;
 
         _glGenerateMipmapTwiddled(tex->color, prevData, thisWidth, thisHeight, thisData);
+        GPUTextureMemoryChanged(thisData, thisWidth * thisHeight * tex->dataStride);
 
         tex->mipmap |= (1 << i);
 
@@ -122,15 +122,28 @@ void APIENTRY glLightModeli(GLenum pname, const GLint param) {
 }
 
 void APIENTRY glLightModelfv(GLenum pname, const GLfloat *params) {
+    if(LIST_COMPILING && (pname == GL_LIGHT_MODEL_AMBIENT || pname == GL_LIGHT_MODEL_LOCAL_VIEWER)) {
+        const GLuint count = (pname == GL_LIGHT_MODEL_AMBIENT) ? 4 : 1;
+
+        GLfloat args[5] = {(GLfloat) pname};
+        memcpy(args + 1, params, sizeof(GLfloat) * count);
+
+        if(!_glListRecord(LIST_CMD_LIGHT_MODEL, args, sizeof(GLfloat) * (count + 1))) {
+            return;
+        }
+    }
+
     switch(pname) {
         case GL_LIGHT_MODEL_AMBIENT: {
             if(memcmp(_glGetLightModelSceneAmbient(), params, sizeof(float) * 4) != 0) {
                 _glSetLightModelSceneAmbient(params);
                 _glPrecalcLightingValues(SCENE_AMBIENT_MASK);
+                _glLightingChanged();
             }
         } break;
         case GL_LIGHT_MODEL_LOCAL_VIEWER:
             _glSetLightModelViewerInEyeCoordinates((*params) ? GL_TRUE : GL_FALSE);
+            _glLightingChanged();
         break;
     case GL_LIGHT_MODEL_TWO_SIDE:
         /* Not implemented */
@@ -140,19 +153,60 @@ void APIENTRY glLightModelfv(GLenum pname, const GLfloat *params) {
 }
 
 void APIENTRY glLightModeliv(GLenum pname, const GLint* params) {
+    if(LIST_COMPILING && (pname == GL_LIGHT_MODEL_COLOR_CONTROL || pname == GL_LIGHT_MODEL_LOCAL_VIEWER)) {
+        if(!_glListRecord(LIST_CMD_LIGHT_MODEL_INT, (const GLuint[]) {pname, (GLuint) *params}, sizeof(GLuint) * 2)) {
+            return;
+        }
+    }
+
     switch(pname) {
         case GL_LIGHT_MODEL_COLOR_CONTROL:
             _glSetLightModelColorControl(*params);
+            _glLightingChanged();
         break;
         case GL_LIGHT_MODEL_LOCAL_VIEWER:
             _glSetLightModelViewerInEyeCoordinates((*params) ? GL_TRUE : GL_FALSE);
+            _glLightingChanged();
         break;
     default:
         _glKosThrowError(GL_INVALID_ENUM, __func__);
     }
 }
 
+/* How many values glLightfv reads for pname, or 0 if it isn't one */
+static GLuint _glLightParamCount(GLenum pname) {
+    switch(pname) {
+        case GL_AMBIENT:
+        case GL_DIFFUSE:
+        case GL_SPECULAR:
+        case GL_POSITION:
+            return 4;
+        case GL_SPOT_DIRECTION:
+            return 3;
+        case GL_CONSTANT_ATTENUATION:
+        case GL_LINEAR_ATTENUATION:
+        case GL_QUADRATIC_ATTENUATION:
+        case GL_SPOT_CUTOFF:
+        case GL_SPOT_EXPONENT:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
 void APIENTRY glLightfv(GLenum light, GLenum pname, const GLfloat *params) {
+    /* Single values are passed on to glLightf, which records them */
+    const GLuint count = _glLightParamCount(pname);
+
+    if(LIST_COMPILING && count > 1) {
+        GLfloat args[6] = {(GLfloat) light, (GLfloat) pname};
+        memcpy(args + 2, params, sizeof(GLfloat) * count);
+
+        if(!_glListRecord(LIST_CMD_LIGHT, args, sizeof(GLfloat) * (count + 2))) {
+            return;
+        }
+    }
+
     GLubyte idx = light & 0xF;
 
     if(idx >= MAX_GLDC_LIGHTS) {
@@ -211,7 +265,7 @@ void APIENTRY glLightfv(GLenum light, GLenum pname, const GLfloat *params) {
         case GL_SPOT_CUTOFF:
         case GL_SPOT_EXPONENT:
             glLightf(light, pname, *params);
-        break;
+        return;
     default:
         _glKosThrowError(GL_INVALID_ENUM, __func__);
         return;
@@ -221,9 +275,16 @@ void APIENTRY glLightfv(GLenum light, GLenum pname, const GLfloat *params) {
         _glPrecalcLightingValues(mask);
     }
 
+    _glLightingChanged();
 }
 
 void APIENTRY glLightf(GLenum light, GLenum pname, GLfloat param) {
+    if(LIST_COMPILING && _glLightParamCount(pname) == 1) {
+        if(!_glListRecord(LIST_CMD_LIGHT, (const GLfloat[]) {(GLfloat) light, (GLfloat) pname, param}, sizeof(GLfloat) * 3)) {
+            return;
+        }
+    }
+
     GLubyte idx = light & 0xF;
 
     if(idx >= MAX_GLDC_LIGHTS) {
@@ -250,16 +311,26 @@ void APIENTRY glLightf(GLenum light, GLenum pname, GLfloat param) {
         break;
     default:
         _glKosThrowError(GL_INVALID_ENUM, __func__);
+        return;
     }
+
+    _glLightingChanged();
 }
 
 void APIENTRY glMaterialf(GLenum face, GLenum pname, const GLfloat param) {
+    if(LIST_COMPILING && pname == GL_SHININESS) {
+        if(!_glListRecord(LIST_CMD_MATERIAL, (const GLfloat[]) {(GLfloat) face, (GLfloat) pname, param}, sizeof(GLfloat) * 3)) {
+            return;
+        }
+    }
+
     if(face == GL_BACK || pname != GL_SHININESS) {
         _glKosThrowError(GL_INVALID_ENUM, __func__);
         return;
     }
 
     _glActiveMaterial()->exponent = _MIN(param, 128);  /* 128 is the max according to the GL spec */
+    _glLightingChanged();
 }
 
 void APIENTRY glMateriali(GLenum face, GLenum pname, const GLint param) {
@@ -267,6 +338,19 @@ void APIENTRY glMateriali(GLenum face, GLenum pname, const GLint param) {
 }
 
 void APIENTRY glMaterialfv(GLenum face, GLenum pname, const GLfloat *params) {
+    /* GL_SHININESS is passed on to glMaterialf, which records it */
+    if(LIST_COMPILING && (
+        pname == GL_AMBIENT || pname == GL_DIFFUSE || pname == GL_SPECULAR ||
+        pname == GL_EMISSION || pname == GL_AMBIENT_AND_DIFFUSE)) {
+
+        GLfloat args[6] = {(GLfloat) face, (GLfloat) pname};
+        memcpy(args + 2, params, sizeof(GLfloat) * 4);
+
+        if(!_glListRecord(LIST_CMD_MATERIAL, args, sizeof(args))) {
+            return;
+        }
+    }
+
     if(face == GL_BACK) {
         _glKosThrowError(GL_INVALID_ENUM, __func__);
         return;
@@ -279,8 +363,7 @@ void APIENTRY glMaterialfv(GLenum face, GLenum pname, const GLfloat *params) {
     switch(pname) {
         case GL_SHININESS:
             glMaterialf(face, pname, *params);
-            rebuild = GL_TRUE;
-        break;
+        return;
         case GL_AMBIENT: {
             if(memcmp(material->ambient, params, sizeof(float) * 4) != 0) {
                 vec4cpy(material->ambient, params);
@@ -331,10 +414,15 @@ void APIENTRY glMaterialfv(GLenum face, GLenum pname, const GLfloat *params) {
                             (pname == GL_AMBIENT_AND_DIFFUSE) ? AMBIENT_MASK | DIFFUSE_MASK : 0;
 
         _glPrecalcLightingValues(updateMask);
+        _glLightingChanged();
     }
 }
 
 void APIENTRY glColorMaterial(GLenum face, GLenum mode) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_COLOR_MATERIAL, (const GLuint[]) {face, mode}, sizeof(GLuint) * 2)) {
+        return;
+    }
+
     if(face != GL_FRONT_AND_BACK) {
         _glKosThrowError(GL_INVALID_ENUM, __func__);
         return;
@@ -353,6 +441,7 @@ void APIENTRY glColorMaterial(GLenum face, GLenum mode) {
 
     _glSetColorMaterialMask(mask);
     _glSetColorMaterialMode(mode);
+    _glLightingChanged();
 }
 
 GL_FORCE_INLINE void bgra_to_float(const uint8_t* input, GLfloat* output) {
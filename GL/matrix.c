@@ -101,15 +101,27 @@ static void recalculateNormalMatrix() {
 }
 
 void APIENTRY glMatrixMode(GLenum mode) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_MATRIX_MODE, &mode, sizeof(mode))) {
+        return;
+    }
+
     MATRIX_MODE = mode;
     MATRIX_IDX = mode & 0xF;
 }
 
 void APIENTRY glPushMatrix() {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_PUSH_MATRIX, NULL, 0)) {
+        return;
+    }
+
     stack_push(MATRIX_STACKS + MATRIX_IDX, stack_top(MATRIX_STACKS + MATRIX_IDX));
 }
 
 void APIENTRY glPopMatrix() {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_POP_MATRIX, NULL, 0)) {
+        return;
+    }
+
     stack_pop(MATRIX_STACKS + MATRIX_IDX);
     if(MATRIX_MODE == GL_MODELVIEW) {
         recalculateNormalMatrix();
@@ -117,10 +129,18 @@ void APIENTRY glPopMatrix() {
 }
 
 void APIENTRY glLoadIdentity() {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_LOAD_IDENTITY, NULL, 0)) {
+        return;
+    }
+
     stack_replace(MATRIX_STACKS + MATRIX_IDX, IDENTITY);
 }
 
 void APIENTRY glTranslatef(GLfloat x, GLfloat y, GLfloat z) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_TRANSLATE, (const GLfloat[]) {x, y, z}, sizeof(GLfloat) * 3)) {
+        return;
+    }
+
     const Matrix4x4 trn __attribute__((aligned(32))) = {
         1.0f, 0.0f, 0.0f, 0.0f,
         0.0f, 1.0f, 0.0f, 0.0f,
@@ -139,6 +159,10 @@ void APIENTRY glTranslatef(GLfloat x, GLfloat y, GLfloat z) {
 
 
 void APIENTRY glScalef(GLfloat x, GLfloat y, GLfloat z) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_SCALE, (const GLfloat[]) {x, y, z}, sizeof(GLfloat) * 3)) {
+        return;
+    }
+
     const Matrix4x4 scale __attribute__((aligned(32))) = {
         x, 0.0f, 0.0f, 0.0f,
         0.0f, y, 0.0f, 0.0f,
@@ -156,6 +180,10 @@ void APIENTRY glScalef(GLfloat x, GLfloat y, GLfloat z) {
 }
 
 void APIENTRY glRotatef(GLfloat angle, GLfloat x, GLfloat  y, GLfloat z) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_ROTATE, (const GLfloat[]) {angle, x, y, z}, sizeof(GLfloat) * 4)) {
+        return;
+    }
+
     Matrix4x4 rotate __attribute__((aligned(32))) = {
         1.0f, 0.0f, 0.0f, 0.0f,
         0.0f, 1.0f, 0.0f, 0.0f,
@@ -200,6 +228,10 @@ void APIENTRY glRotatef(GLfloat angle, GLfloat x, GLfloat  y, GLfloat z) {
 
 /* Load an arbitrary matrix */
 void APIENTRY glLoadMatrixf(const GLfloat *m) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_LOAD_MATRIX, m, sizeof(GLfloat) * 16)) {
+        return;
+    }
+
     static Matrix4x4 TEMP;
 
     TEMP[M0] = m[0];
@@ -288,6 +320,10 @@ void APIENTRY glFrustum(GLfloat left, GLfloat right,
 
 /* Multiply the current matrix by an arbitrary matrix */
 void glMultMatrixf(const GLfloat *m) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_MULT_MATRIX, m, sizeof(GLfloat) * 16)) {
+        return;
+    }
+
     Matrix4x4 TEMP __attribute__((aligned(32)));
     const Matrix4x4 *pMatrix;
 
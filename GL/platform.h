@@ -141,6 +141,15 @@ typedef enum GPUPaletteFormat {
     GPU_PAL_ARGB8888 = 3
 } GPUPaletteFormat;
 
+/* Pixel layouts GPUReadPixels can convert the framebuffer to, as they're
+ * laid out in memory */
+typedef enum GPUReadFormat {
+    GPU_READ_RGBA8888,
+    GPU_READ_BGRA8888,
+    GPU_READ_RGB888,
+    GPU_READ_RGB565
+} GPUReadFormat;
+
 typedef enum GPUFog {
     GPU_FOG_TABLE = 0,
     GPU_FOG_VERTEX = 1,
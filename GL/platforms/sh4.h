@@ -179,6 +179,50 @@ static inline void GPUSetClearDepth(float v) {
     pvr_set_zclip(v);
 }
 
+/* The PVR renders tiles in hardware */
+static inline void GPUSetThreadCount(uint32_t count) {
+    (void) count;
+}
+
+/* The PVR samples textures straight from VRAM */
+static inline void GPUSetTextureCacheSize(size_t bytes) {
+    (void) bytes;
+}
+
+static inline void GPUTextureMemoryChanged(const void* ptr, size_t size) {
+    (void) ptr;
+    (void) size;
+}
+
+static inline void GPUSetResolutionDivisor(uint32_t divisor) {
+    _GL_UNUSED(divisor);
+}
+
+static inline void GPUSetTargetFrameTime(uint32_t microseconds) {
+    _GL_UNUSED(microseconds);
+}
+
+/* Not supported yet, the lists are dropped instead */
+static inline bool GPUSetRenderTexture(void* data, uint16_t width, uint16_t height, uint32_t format) {
+    _GL_UNUSED(width);
+    _GL_UNUSED(height);
+    _GL_UNUSED(format);
+    return data == NULL;
+}
+
+/* The PVR renders straight to video memory, reading it back isn't
+ * supported */
+static inline bool GPUReadPixels(uint16_t x, uint16_t y, uint16_t width, uint16_t height, GPUReadFormat format, size_t stride, void* pixels) {
+    _GL_UNUSED(x);
+    _GL_UNUSED(y);
+    _GL_UNUSED(width);
+    _GL_UNUSED(height);
+    _GL_UNUSED(format);
+    _GL_UNUSED(stride);
+    _GL_UNUSED(pixels);
+    return false;
+}
+
 static inline void GPUSetFogLinear(float start, float end) {
     pvr_fog_table_linear(start, end);
 }
@@ -1,133 +1,245 @@
-#include <SDL.h>
-
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "../private.h"
 #include "../platform.h"
 #include "software.h"
-#include "software/edge_equation.h"
-#include "software/parameter_equation.h"
+#include "software/display.h"
+#include "software/rasterizer.h"
+#include "software/texture_cache.h"
+#include "software/tiles.h"
+#include "software/workers.h"
 
 #define CLIP_DEBUG 0
 
-static size_t AVAILABLE_VRAM = 16 * 1024 * 1024;
+static size_t AVAILABLE_VRAM = TEXTURE_MEMORY_SIZE;
 static Matrix4x4 MATRIX;
 
-static SDL_Window* WINDOW = NULL;
-static SDL_Renderer* RENDERER = NULL;
+/* Stands in for PVR VRAM. GPUMemoryAlloc hands out pieces of it, so that
+ * the texture offsets in poly headers can be turned back into pointers */
+static uint8_t* VRAM = NULL;
 
 static uint8_t BACKGROUND_COLOR[3] = {0, 0, 0};
+static float CLEAR_DEPTH = 0.0f;
+static uint8_t ALPHA_CUTOFF = 0;
+
+/* Like the PVR fog table registers, the table is shared by the whole
+ * frame. The GPUSetFog* calls only record what's asked for, it's built
+ * at the start of the next frame if anything changed. */
+static FogTable FOG;
 
-GPUCulling CULL_MODE = GPU_CULLING_CCW;
+static struct {
+    enum { FOG_LINEAR, FOG_EXP, FOG_EXP2 } mode;
+    float start;
+    float end;
+    float density;
+    bool dirty;
+} FOG_PARAMS;
+
+/* Colour and depth buffers, vid_mode.width * vid_mode.height. Scenes for
+ * the display are rasterized into SCREEN_TARGET, and its colour is handed to
+ * the display once per frame in SceneFinish. Scenes rendered to a texture
+ * get their own TEXTURE_TARGET, created the first time one is, so they
+ * don't overwrite the frame on show. TARGET is whichever the current scene
+ * is using. */
+static RenderTarget SCREEN_TARGET;
+static RenderTarget TEXTURE_TARGET;
+static RenderTarget* TARGET = &SCREEN_TARGET;
+
+/* Scenes can be rasterized at a fraction of the video mode on each axis,
+ * which the vertices are scaled down to, and blown back up into PRESENT
+ * when they're shown. SCENE holds the last scene at full size, for
+ * GPUReadPixels.
+ *
+ * With RESOLUTION_AUTO the divisor is picked from the time the last few
+ * frames took to rasterize, to keep it under TARGET_FRAME_TIME. */
+#define RESOLUTION_DIVISOR_MAX 4
+
+static uint32_t RESOLUTION_DIVISOR = 1;
+static bool RESOLUTION_AUTO = false;
+static float TARGET_FRAME_TIME = 1.0f / 60.0f;
+
+/* What the scene being rendered uses */
+static uint32_t SCENE_DIVISOR = 1;
+static float RESOLUTION_SCALE = 1.0f;
+
+static uint32_t* PRESENT = NULL;
+static const uint32_t* SCENE = NULL;
+
+static struct {
+    struct timespec start;
+    float average;      /* Seconds spent rasterizing a frame, smoothed */
+    uint32_t frames;    /* Since the divisor last changed */
+} SCENE_TIME;
+
+/* Set while a scene is being rendered to a texture rather than the
+ * display, SceneFinish writes the bottom left of the colour buffer into
+ * it instead of presenting it */
+static struct {
+    uint8_t* data;
+    uint16_t width;
+    uint16_t height;
+    TexelFormat format;
+    bool twiddled;
+} RENDER_TEXTURE;
+
+/* The list being submitted, decoded as it arrives: the vertices after
+ * the perspective divide, each header and the PolyState decoded from it,
+ * and the triangles set up from the strips. Rendering then only has to
+ * bin the triangles into screen tiles and rasterize them.
+ *
+ * Once a strip ends with more than VERTEX_CHUNK_SIZE vertices queued,
+ * they're rendered straight away and the list starts over, so memory use
+ * doesn't grow with the size of a list. Only a single strip longer than
+ * that makes the buffers grow. */
+#define VERTEX_CHUNK_SIZE (1024 * 32)
+
+static AlignedVector VERTICES;
+static AlignedVector HEADERS;
+static AlignedVector STATES;
+static AlignedVector TRIANGLES;
+static TileBins BINS;
+
+static GPUList LIST = GPU_LIST_OP_POLY;
+
+/* The rectangle set by the last user clip command of the list, in pixels.
+ * Headers which clip to it (see GPU_TA_CMD_USERCLIP_MASK) take a copy of
+ * it into their PolyState. */
+static Rect USER_CLIP;
+
+/* Whether the chunk being rendered only has polygons which replace the
+ * colour, so it can be shaded once per pixel after depth testing */
+static bool DEFERRED = false;
+
+/* Translucent polygons are sorted per pixel when autosort is enabled, like
+ * the PVR does. Each worker collects the fragments of a tile in its own
+ * buffer, a tile which doesn't fit is drawn in submission order instead.
+ * Lists too big for one chunk are sorted a chunk at a time. */
+#define TILE_FRAGMENTS (TILE_SIZE * TILE_SIZE * 8)
+
+static bool AUTOSORT = false;
+static bool SORTED = false;
+static FragmentBuffer* FRAGMENTS = NULL;
+static uint32_t FRAGMENT_BUFFER_COUNT = 0;
+
+/* The strip being submitted. Neighbouring triangles of a strip share two
+ * vertices and the edge between them, so those are kept from one triangle
+ * to the next rather than worked out again. */
+static struct {
+    uint32_t count;             /* Vertices so far */
+    uint32_t index[2];          /* The last two, oldest first */
+    int32_t position[2][2];     /* Their snapped positions */
+    EdgeEquation edge;          /* From the second last to the last */
+} STRIP;
 
 
 static VideoMode vid_mode = {
     640, 480
 };
 
-#define MIN(x, y) ((x) < (y) ? (x) : (y))
-#define MAX(x, y) ((x) > (y) ? (x) : (y))
+void InitGPU(_Bool autosort, _Bool fsaa) {
+    _GL_UNUSED(fsaa);
 
-static void DrawTriangle(Vertex* v0, Vertex* v1, Vertex* v2) {
-    // Compute triangle bounding box.
+    AUTOSORT = autosort;
 
-    int minX = MIN(MIN(v0->xyz[0], v1->xyz[0]), v2->xyz[0]);
-    int maxX = MAX(MAX(v0->xyz[0], v1->xyz[0]), v2->xyz[0]);
-    int minY = MIN(MIN(v0->xyz[1], v1->xyz[1]), v2->xyz[1]);
-    int maxY = MAX(MAX(v0->xyz[1], v1->xyz[1]), v2->xyz[1]);
+    RenderTargetInit(&SCREEN_TARGET, vid_mode.width, vid_mode.height);
+    SCENE = SCREEN_TARGET.colour;
 
-    // Clip to scissor rect.
+    VRAM = (uint8_t*) memalign(TEXTURE_MEMORY_SIZE, TEXTURE_MEMORY_SIZE);
+    AVAILABLE_VRAM = TEXTURE_MEMORY_SIZE;
+    TextureCacheInit();
 
-    minX = MAX(minX, 0);
-    maxX = MIN(maxX, vid_mode.width);
-    minY = MAX(minY, 0);
-    maxY = MIN(maxY, vid_mode.height);
+    aligned_vector_init(&VERTICES, sizeof(Vertex));
+    aligned_vector_init(&HEADERS, sizeof(PolyHeader));
+    aligned_vector_init(&STATES, sizeof(PolyState));
+    aligned_vector_init(&TRIANGLES, sizeof(Triangle));
+    aligned_vector_reserve(&VERTICES, VERTEX_CHUNK_SIZE + 256);
+    TileBinsInit(&BINS, vid_mode.width, vid_mode.height);
 
-    // Compute edge equations.
+    DisplayInit(vid_mode.width, vid_mode.height);
+}
 
-    EdgeEquation e0, e1, e2;
-    EdgeEquationInit(&e0, &v0->xyz[0], &v1->xyz[0]);
-    EdgeEquationInit(&e1, &v1->xyz[0], &v2->xyz[0]);
-    EdgeEquationInit(&e2, &v2->xyz[0], &v0->xyz[0]);
+static void FogUpdate() {
+    if(!FOG_PARAMS.dirty) {
+        return;
+    }
 
-    float area = 0.5 * (e0.c + e1.c + e2.c);
+    switch(FOG_PARAMS.mode) {
+        case FOG_LINEAR:
+            FogTableLinear(&FOG, FOG_PARAMS.start, FOG_PARAMS.end);
+        break;
+        case FOG_EXP:
+            FogTableExp(&FOG, FOG_PARAMS.density);
+        break;
+        case FOG_EXP2:
+            FogTableExp2(&FOG, FOG_PARAMS.density);
+        break;
+    }
 
-    /* This is very ugly. I don't understand the math properly
-     * so I just swap the vertex order if something is back-facing
-     * and we want to render it. Patches welcome! */
-#define REVERSE_WINDING() \
-    Vertex* tv = v0; \
-    v0 = v1; \
-    v1 = tv; \
-    EdgeEquationInit(&e0, &v0->xyz[0], &v1->xyz[0]); \
-    EdgeEquationInit(&e1, &v1->xyz[0], &v2->xyz[0]); \
-    EdgeEquationInit(&e2, &v2->xyz[0], &v0->xyz[0]); \
-    area = 0.5f * (e0.c + e1.c + e2.c) \
+    FOG_PARAMS.dirty = false;
+}
 
-    // Check if triangle is backfacing.
-    if(CULL_MODE == GPU_CULLING_CCW) {
-        if(area < 0) {
-            return;
-        }
-    } else if(CULL_MODE == GPU_CULLING_CW) {
-        if(area < 0) {
-            // We only draw front-facing polygons, so swap
-            // the back to front and draw
-            REVERSE_WINDING();
-        } else {
-            // Front facing, so bail
-            return;
-        }
-    } else if(area < 0) {
-        /* We're not culling, but this is backfacing, so swap vertices and edges */
-        REVERSE_WINDING();
+/* Picks the divisor for the next frame from how long the last ones took.
+ * Going down a step has roughly four times the pixels to fill, so that's
+ * only done when there's plenty of time to spare. */
+static void ResolutionUpdate(float seconds) {
+    if(!SCENE_TIME.frames) {
+        SCENE_TIME.average = seconds;
+    } else {
+        SCENE_TIME.average += (seconds - SCENE_TIME.average) * 0.25f;
     }
 
-    ParameterEquation r, g, b;
+    /* Let the average settle after a change */
+    if(++SCENE_TIME.frames < 8) {
+        return;
+    }
 
-    ParameterEquationInit(&r, v0->bgra[2], v1->bgra[2], v2->bgra[2], &e0, &e1, &e2, area);
-    ParameterEquationInit(&g, v0->bgra[1], v1->bgra[1], v2->bgra[1], &e0, &e1, &e2, area);
-    ParameterEquationInit(&b, v0->bgra[0], v1->bgra[0], v2->bgra[0], &e0, &e1, &e2, area);
+    uint32_t divisor = RESOLUTION_DIVISOR;
 
-    // Add 0.5 to sample at pixel centers.
-    for (float x = minX + 0.5f, xm = maxX + 0.5f; x <= xm; x += 1.0f)
-    for (float y = minY + 0.5f, ym = maxY + 0.5f; y <= ym; y += 1.0f)
-    {
-      if (EdgeEquationTestPoint(&e0, x, y) && EdgeEquationTestPoint(&e1, x, y) && EdgeEquationTestPoint(&e2, x, y)) {
-        int rint = ParameterEquationEvaluate(&r, x, y);
-        int gint = ParameterEquationEvaluate(&g, x, y);
-        int bint = ParameterEquationEvaluate(&b, x, y);
-        SDL_SetRenderDrawColor(RENDERER, rint, gint, bint, 255);
-        SDL_RenderDrawPoint(RENDERER, x, y);
-      }
+    if(SCENE_TIME.average > TARGET_FRAME_TIME && divisor < RESOLUTION_DIVISOR_MAX) {
+        divisor *= 2;
+    } else if(SCENE_TIME.average * 6.0f < TARGET_FRAME_TIME && divisor > 1) {
+        divisor /= 2;
+    }
+
+    if(divisor != RESOLUTION_DIVISOR) {
+        RESOLUTION_DIVISOR = divisor;
+        SCENE_TIME.frames = 0;
     }
 }
 
+void SceneBegin() {
+    FogUpdate();
 
-void InitGPU(_Bool autosort, _Bool fsaa) {
-    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
+    /* Textures are always rendered at full size */
+    SCENE_DIVISOR = (RENDER_TEXTURE.data) ? 1 : RESOLUTION_DIVISOR;
+    RESOLUTION_SCALE = 1.0f / SCENE_DIVISOR;
 
-    WINDOW = SDL_CreateWindow(
-        "GLdc",
-        SDL_WINDOWPOS_UNDEFINED,
-        SDL_WINDOWPOS_UNDEFINED,
-        vid_mode.width, vid_mode.height,
-        SDL_WINDOW_SHOWN
-    );
+    if(RENDER_TEXTURE.data) {
+        if(!TEXTURE_TARGET.colour) {
+            RenderTargetInit(&TEXTURE_TARGET, vid_mode.width, vid_mode.height);
+        }
 
-    RENDERER = SDL_CreateRenderer(
-        WINDOW, -1, SDL_RENDERER_ACCELERATED
-    );
-}
+        TARGET = &TEXTURE_TARGET;
+    } else {
+        TARGET = &SCREEN_TARGET;
+    }
 
-void SceneBegin() {
-    SDL_SetRenderDrawColor(RENDERER, BACKGROUND_COLOR[0], BACKGROUND_COLOR[1], BACKGROUND_COLOR[2], 0);
-    SDL_RenderClear(RENDERER);
-}
+    RenderTargetResize(TARGET, vid_mode.width / SCENE_DIVISOR, vid_mode.height / SCENE_DIVISOR);
+    TileBinsResize(&BINS, TARGET->width, TARGET->height);
+
+    if(RESOLUTION_AUTO) {
+        clock_gettime(CLOCK_MONOTONIC, &SCENE_TIME.start);
+    }
 
-static Vertex BUFFER[1024 * 32];
-static uint32_t vertex_counter = 0;
+    const uint32_t clear = 0xFF000000 |
+        (BACKGROUND_COLOR[0] << 16) |
+        (BACKGROUND_COLOR[1] << 8) |
+        BACKGROUND_COLOR[2];
+
+    RenderTargetClear(TARGET, clear, CLEAR_DEPTH);
+}
 
 GL_FORCE_INLINE bool glIsVertex(const float flags) {
     return flags == GPU_CMD_VERTEX_EOL || flags == GPU_CMD_VERTEX;
@@ -138,21 +250,37 @@ GL_FORCE_INLINE bool glIsLastVertex(const float flags) {
 }
 
 
+static void ListClear() {
+    aligned_vector_clear(&VERTICES);
+    aligned_vector_clear(&HEADERS);
+    aligned_vector_clear(&STATES);
+    aligned_vector_clear(&TRIANGLES);
+    STRIP.count = 0;
+}
+
 void SceneListBegin(GPUList list) {
-    vertex_counter = 0;
+    LIST = list;
+    ListClear();
+
+    USER_CLIP.left = 0;
+    USER_CLIP.top = 0;
+    USER_CLIP.right = TARGET->width - 1;
+    USER_CLIP.bottom = TARGET->height - 1;
 }
 
+static void RenderChunk();
+
 GL_FORCE_INLINE void _glPerspectiveDivideVertex(Vertex* vertex, const float h) {
     const float f = 1.0f / (vertex->w);
 
     /* Convert to NDC and apply viewport */
     vertex->xyz[0] = __builtin_fmaf(
         VIEWPORT.hwidth, vertex->xyz[0] * f, VIEWPORT.x_plus_hwidth
-    );
+    ) * RESOLUTION_SCALE;
 
-    vertex->xyz[1] = h - __builtin_fmaf(
+    vertex->xyz[1] = (h - __builtin_fmaf(
         VIEWPORT.hheight, vertex->xyz[1] * f, VIEWPORT.y_plus_hheight
-    );
+    )) * RESOLUTION_SCALE;
 
     if(vertex->w == 1.0f) {
         vertex->xyz[2] = 1.0f / (1.0001f + vertex->xyz[2]);
@@ -161,6 +289,110 @@ GL_FORCE_INLINE void _glPerspectiveDivideVertex(Vertex* vertex, const float h) {
     }
 }
 
+static void ListSubmitHeader(const PolyHeader* header) {
+    aligned_vector_push_back(&HEADERS, header, 1);
+
+    PolyState* state = (PolyState*) aligned_vector_extend(&STATES, 1);
+    PolyStateInit(state, header, VRAM, &FOG);
+    state->clip = USER_CLIP;
+
+    STRIP.count = 0;
+}
+
+static void ListSubmitUserClip(const PVRTileClipCommand* command) {
+    /* The command is in (inclusive) tiles of the video mode, it can run
+     * past the edge of the target. An end before the start leaves nothing
+     * inside. */
+    USER_CLIP.left = (command->sx * TILE_SIZE) / SCENE_DIVISOR;
+    USER_CLIP.top = (command->sy * TILE_SIZE) / SCENE_DIVISOR;
+    USER_CLIP.right = ((command->ex + 1) * TILE_SIZE) / SCENE_DIVISOR - 1;
+    USER_CLIP.bottom = ((command->ey + 1) * TILE_SIZE) / SCENE_DIVISOR - 1;
+
+    /* Polygons which come after this still belong to the last header, so
+     * if that one clips it has to be started again with the new rectangle */
+    if(STATES.size) {
+        const PolyState* state = (const PolyState*) aligned_vector_back(&STATES);
+        if(state->clip_mode != GPU_USERCLIP_DISABLE) {
+            PolyHeader header = *(const PolyHeader*) aligned_vector_back(&HEADERS);
+            ListSubmitHeader(&header);
+        }
+    }
+}
+
+static void ListSubmitVertex(const Vertex* v) {
+    /* The vector only grows by a fixed amount at a time, which would make
+     * a very long strip quadratic to copy */
+    if(VERTICES.size == VERTICES.capacity) {
+        aligned_vector_reserve(&VERTICES, VERTICES.capacity * 2);
+    }
+
+    const uint32_t index = VERTICES.size;
+    aligned_vector_push_back(&VERTICES, v, 1);
+
+    int32_t position[2];
+    VertexSnap(v, position);
+
+    EdgeEquation edge;
+    if(STRIP.count) {
+        EdgeEquationInit(&edge, STRIP.position[1], position);
+    }
+
+    if(STRIP.count >= 2 && STATES.size) {
+        const PolyState* state = (const PolyState*) aligned_vector_back(&STATES);
+
+        /* The edge closing the triangle is the only new one, the others
+         * are the last edge of the strip and the one just made */
+        EdgeEquation closing;
+        EdgeEquationInit(&closing, position, STRIP.position[0]);
+
+        /* Every other triangle of a strip winds the opposite way, its
+         * first two vertices are swapped to make up for it */
+        uint32_t indices[3];
+        int32_t p[3][2];
+        EdgeEquation e[3];
+
+        if(STRIP.count % 2 == 0) {
+            indices[0] = STRIP.index[1];
+            indices[1] = STRIP.index[0];
+            memcpy(p[0], STRIP.position[1], sizeof(p[0]));
+            memcpy(p[1], STRIP.position[0], sizeof(p[1]));
+            EdgeEquationReverse(&e[0], &STRIP.edge);
+            EdgeEquationReverse(&e[1], &closing);
+            EdgeEquationReverse(&e[2], &edge);
+        } else {
+            indices[0] = STRIP.index[0];
+            indices[1] = STRIP.index[1];
+            memcpy(p[0], STRIP.position[0], sizeof(p[0]));
+            memcpy(p[1], STRIP.position[1], sizeof(p[1]));
+            e[0] = STRIP.edge;
+            e[1] = edge;
+            e[2] = closing;
+        }
+
+        indices[2] = index;
+        memcpy(p[2], position, sizeof(p[2]));
+
+        Triangle* tri = (Triangle*) aligned_vector_extend(&TRIANGLES, 1);
+        if(TriangleSetup(tri, indices, (const int32_t (*)[2]) p, e, state, TARGET)) {
+            tri->state = STATES.size - 1;
+        } else {
+            aligned_vector_resize(&TRIANGLES, TRIANGLES.size - 1);
+        }
+    }
+
+    if(v->flags == GPU_CMD_VERTEX_EOL) {
+        STRIP.count = 0;
+        return;
+    }
+
+    STRIP.index[0] = STRIP.index[1];
+    STRIP.index[1] = index;
+    memcpy(STRIP.position[0], STRIP.position[1], sizeof(STRIP.position[0]));
+    memcpy(STRIP.position[1], position, sizeof(STRIP.position[1]));
+    STRIP.edge = edge;
+    STRIP.count++;
+}
+
 GL_FORCE_INLINE void _glSubmitHeaderOrVertex(const Vertex* v) {
 #ifndef NDEBUG
     if(glIsVertex(v->flags)) {
@@ -173,7 +405,23 @@ GL_FORCE_INLINE void _glSubmitHeaderOrVertex(const Vertex* v) {
     printf("Submitting: %x (%x)\n", v, v->flags);
 #endif
 
-    BUFFER[vertex_counter++] = *v;
+    if((v->flags & GPU_CMD_POLYHDR) == GPU_CMD_POLYHDR) {
+        ListSubmitHeader((const PolyHeader*) v);
+    } else if(glIsVertex(v->flags)) {
+        ListSubmitVertex(v);
+
+        if(v->flags == GPU_CMD_VERTEX_EOL && VERTICES.size >= VERTEX_CHUNK_SIZE) {
+            /* Start the next chunk with the header the list is up to, so
+             * its vertices still know how they're meant to be drawn */
+            PolyHeader header = *(const PolyHeader*) aligned_vector_back(&HEADERS);
+
+            RenderChunk();
+            ListClear();
+            ListSubmitHeader(&header);
+        }
+    } else if(v->flags == GPU_CMD_USERCLIP) {
+        ListSubmitUserClip((const PVRTileClipCommand*) v);
+    }
 }
 
 static struct {
@@ -261,7 +509,7 @@ void SceneListSubmit(void* src, int n) {
     const float h = GetVideoMode()->height;
 
     /* If Z-clipping is disabled, just fire everything over to the buffer */
-    if(!ZNEAR_CLIPPING_ENABLED) {
+    if(!_glNearZClippingEnabled()) {
         for(int i = 0; i < n; ++i, ++vertex) {
             PREFETCH(vertex + 1);
             if(glIsVertex(vertex->flags)) {
@@ -507,58 +755,281 @@ void SceneListSubmit(void* src, int n) {
     }
 }
 
+static void RenderTile(uint32_t tile, uint32_t worker, void* userdata) {
+    _GL_UNUSED(userdata);
+
+    Rect clip;
+    TileRect(&BINS, tile, TARGET, &clip);
+
+    const Triangle* triangles = (const Triangle*) TRIANGLES.data;
+    const PolyState* states = (const PolyState*) STATES.data;
+    const Vertex* vertices = (const Vertex*) VERTICES.data;
+    const uint32_t* indices = (const uint32_t*) BINS.indices.data;
+    const uint32_t start = BINS.offsets[tile];
+    const uint32_t end = BINS.offsets[tile + 1];
+
+    if(SORTED) {
+        FragmentBuffer* buffer = &FRAGMENTS[worker];
+        FragmentBufferReset(buffer, &clip);
+
+        for(uint32_t i = start; i < end && !buffer->overflow; ++i) {
+            const Triangle* tri = &triangles[indices[i]];
+            RasterizeTriangleFragments(TARGET, tri, vertices, &states[tri->state], buffer);
+        }
+
+        if(!buffer->overflow) {
+            FragmentBufferResolve(buffer, TARGET, states);
+            return;
+        }
+    }
+
+    if(!DEFERRED) {
+        for(uint32_t i = start; i < end; ++i) {
+            const Triangle* tri = &triangles[indices[i]];
+            RasterizeTriangle(TARGET, tri, vertices, &states[tri->state], &clip);
+        }
+
+        return;
+    }
+
+    /* Resolve which triangle is visible at each pixel of the tile, then
+     * shade each of those pixels once. Ids are the triangle index + 1,
+     * so that 0 means nothing was drawn. */
+    uint32_t ids[TILE_SIZE * TILE_SIZE];
+    memset(ids, 0, sizeof(ids));
+
+    for(uint32_t i = start; i < end; ++i) {
+        const Triangle* tri = &triangles[indices[i]];
+        RasterizeTriangleDepth(TARGET, tri, vertices, &states[tri->state], &clip, indices[i] + 1, ids, TILE_SIZE);
+    }
+
+    for(uint32_t i = start; i < end; ++i) {
+        const Triangle* tri = &triangles[indices[i]];
+        ShadeTriangle(TARGET, tri, vertices, &states[tri->state], &clip, indices[i] + 1, ids, TILE_SIZE);
+    }
+}
+
+/* Renders everything queued in the list */
+static void RenderChunk() {
+    /* Texture memory and the cut-off can change while a list is being
+     * submitted, so they're only looked at now that it's being drawn */
+    TextureCacheBeginList();
+
+    PolyState* state = (PolyState*) STATES.data;
+    const PolyHeader* header = (const PolyHeader*) HEADERS.data;
+
+    /* Opaque polygons normally all replace what's behind them, but the
+     * blend mode can still be changed for the list */
+    DEFERRED = (LIST == GPU_LIST_OP_POLY);
+
+    for(uint32_t i = 0; i < STATES.size; ++i, ++state, ++header) {
+        state->alpha_cutoff = ALPHA_CUTOFF;
+        DEFERRED &= (state->blend == BLEND_REPLACE && !state->punch_through);
+
+        if(state->textured) {
+            state->texture.decoded = TextureCacheLookup(&state->texture, header);
+        }
+    }
+
+    SORTED = AUTOSORT && LIST == GPU_LIST_TR_POLY;
+
+    if(SORTED && FRAGMENT_BUFFER_COUNT < WorkersCount()) {
+        FRAGMENTS = (FragmentBuffer*) realloc(FRAGMENTS, sizeof(FragmentBuffer) * WorkersCount());
+
+        for(; FRAGMENT_BUFFER_COUNT < WorkersCount(); ++FRAGMENT_BUFFER_COUNT) {
+            FragmentBufferInit(&FRAGMENTS[FRAGMENT_BUFFER_COUNT], TILE_FRAGMENTS, TILE_SIZE, TILE_SIZE);
+        }
+    }
+
+    TileBinsBuild(&BINS, (const Triangle*) TRIANGLES.data, TRIANGLES.size, (const PolyState*) STATES.data);
+
+    /* Tiles don't overlap and each one draws its triangles in submission
+     * order, so it doesn't matter which thread picks up which tile */
+    WorkersRun(RenderTile, NULL, BINS.columns * BINS.rows);
+}
+
 void SceneListFinish() {
-    uint32_t vidx = 0;
-    const uint32_t* flags = (const uint32_t*) BUFFER;
-    uint32_t step = sizeof(Vertex) / sizeof(uint32_t);
+    RenderChunk();
+    ListClear();
+}
 
-    for(int i = 0; i < vertex_counter; ++i, flags += step) {
-        if((*flags & GPU_CMD_POLYHDR) == GPU_CMD_POLYHDR) {
-            vidx = 0;
+static void RenderTextureWrite() {
+    uint16_t* out = (uint16_t*) RENDER_TEXTURE.data;
+    const uint16_t width = RENDER_TEXTURE.width;
+    const uint16_t height = RENDER_TEXTURE.height;
 
-            uint32_t mode1 = *(flags + 1);
-            // Extract culling mode
-            uint32_t mask = mode1 & GPU_TA_PM1_CULLING_MASK;
-            CULL_MODE = mask >> GPU_TA_PM1_CULLING_SHIFT;
+    /* Texture rows count up from the bottom of the viewport, as GL
+     * expects. Anything bigger than the target is left alone. */
+    const int columns = MIN(width, TARGET->width);
+    const int rows = MIN(height, TARGET->height);
 
-        } else {
-            switch(*flags) {
-            case GPU_CMD_VERTEX_EOL:
-            case GPU_CMD_VERTEX: // Fallthrough
-                vidx++;
-            break;
-            default:
+    for(int y = 0; y < rows; ++y) {
+        const uint32_t* in = TARGET->colour + ((TARGET->height - 1 - y) * TARGET->width);
+
+        for(int x = 0; x < columns; ++x) {
+            const uint32_t p = in[x];
+            uint16_t texel;
+
+            switch(RENDER_TEXTURE.format) {
+                case TEXEL_RGB565:
+                    texel = ((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F);
+                break;
+                case TEXEL_ARGB1555:
+                    texel = ((p >> 16) & 0x8000) | ((p >> 9) & 0x7C00) | ((p >> 6) & 0x03E0) | ((p >> 3) & 0x001F);
+                break;
+                case TEXEL_ARGB4444:
+                default:
+                    texel = ((p >> 16) & 0xF000) | ((p >> 12) & 0x0F00) | ((p >> 8) & 0x00F0) | ((p >> 4) & 0x000F);
                 break;
             }
+
+            const uint32_t index = (RENDER_TEXTURE.twiddled) ?
+                TwiddledIndex(x, y, width, height) : (uint32_t) ((y * width) + x);
+
+            out[index] = texel;
         }
+    }
 
-        if(vidx > 2) {
-            Vertex* v0 = (Vertex*) (flags - step - step);
-            Vertex* v1 = (Vertex*) (flags - step);
-            Vertex* v2 = (Vertex*) (flags);
-            (vidx % 2 == 0) ? DrawTriangle(v0, v1, v2) : DrawTriangle(v1, v0, v2);
+    GPUTextureMemoryChanged(RENDER_TEXTURE.data, width * height * sizeof(uint16_t));
+}
+
+/* Blows the colour buffer up to the video mode, by repeating pixels. A
+ * video mode which doesn't divide evenly leaves a black edge. */
+static void ResolutionUpscale() {
+    const uint32_t divisor = SCENE_DIVISOR;
+
+    if(!PRESENT) {
+        PRESENT = (uint32_t*) calloc(vid_mode.width * vid_mode.height, sizeof(uint32_t));
+    }
+
+    const uint32_t* in = TARGET->colour;
+
+    for(int y = 0; y < TARGET->height; ++y, in += TARGET->width) {
+        uint32_t* row = PRESENT + (y * divisor * vid_mode.width);
+        uint32_t* out = row;
+
+        for(int x = 0; x < TARGET->width; ++x) {
+            const uint32_t p = in[x];
+            for(uint32_t i = 0; i < divisor; ++i) {
+                *out++ = p;
+            }
         }
 
-        if((*flags) == GPU_CMD_VERTEX_EOL) {
-            vidx = 0;
+        for(uint32_t i = 1; i < divisor; ++i) {
+            memcpy(row + (i * vid_mode.width), row, sizeof(uint32_t) * TARGET->width * divisor);
         }
     }
 }
 
 void SceneFinish() {
-    SDL_RenderPresent(RENDERER);
-    return;
-    /* Only sensible place to hook the quit signal */
-    SDL_Event e;
-    while (SDL_PollEvent(&e)) {
-        switch (e.type) {
-            case SDL_QUIT:
-              exit(0);
-              break;
+    if(RENDER_TEXTURE.data) {
+        RenderTextureWrite();
+        return;
+    }
+
+    if(RESOLUTION_AUTO) {
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        ResolutionUpdate(
+            (end.tv_sec - SCENE_TIME.start.tv_sec) +
+            (end.tv_nsec - SCENE_TIME.start.tv_nsec) * 1e-9f
+        );
+    }
+
+    if(SCENE_DIVISOR > 1) {
+        ResolutionUpscale();
+        SCENE = PRESENT;
+    } else {
+        SCENE = TARGET->colour;
+    }
+
+    DisplayPresent(SCENE, vid_mode.width, vid_mode.height);
+}
+
+void GPUSetResolutionDivisor(uint32_t divisor) {
+    RESOLUTION_AUTO = (divisor == 0);
+    SCENE_TIME.frames = 0;
+
+    if(divisor == 2 || divisor == 4) {
+        RESOLUTION_DIVISOR = divisor;
+    } else {
+        RESOLUTION_DIVISOR = 1;
+    }
+}
+
+void GPUSetTargetFrameTime(uint32_t microseconds) {
+    TARGET_FRAME_TIME = microseconds * 1e-6f;
+}
+
+bool GPUSetRenderTexture(void* data, uint16_t width, uint16_t height, uint32_t format) {
+    RENDER_TEXTURE.data = NULL;
+
+    if(!data) {
+        return true;
+    }
+
+    const TexelFormat texel_format = (TexelFormat) ((format >> 27) & 7);
+
+    /* Only the 16 bit colour formats can be drawn into */
+    if((format & GPU_TXRFMT_VQ_ENABLE) || (
+        texel_format != TEXEL_RGB565 &&
+        texel_format != TEXEL_ARGB1555 &&
+        texel_format != TEXEL_ARGB4444)) {
+        return false;
+    }
+
+    RENDER_TEXTURE.data = (uint8_t*) data;
+    RENDER_TEXTURE.width = width;
+    RENDER_TEXTURE.height = height;
+    RENDER_TEXTURE.format = texel_format;
+    RENDER_TEXTURE.twiddled = !(format & GPU_TXRFMT_NONTWIDDLED);
+    return true;
+}
+
+bool GPUReadPixels(uint16_t x, uint16_t y, uint16_t width, uint16_t height, GPUReadFormat format, size_t stride, void* pixels) {
+    gl_assert(x + width <= vid_mode.width);
+    gl_assert(y + height <= vid_mode.height);
+
+    uint8_t* out = (uint8_t*) pixels;
+
+    for(int row = y + height - 1; row >= y; --row, out += stride) {
+        const uint32_t* in = SCENE + (row * vid_mode.width) + x;
+
+        switch(format) {
+            case GPU_READ_BGRA8888:
+                /* Already the layout of the colour buffer */
+                memcpy(out, in, width * sizeof(uint32_t));
+            break;
+            case GPU_READ_RGBA8888: {
+                uint32_t* dst = (uint32_t*) out;
+                for(int i = 0; i < width; ++i) {
+                    const uint32_t p = in[i];
+                    dst[i] = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+                }
+            } break;
+            case GPU_READ_RGB888: {
+                uint8_t* dst = out;
+                for(int i = 0; i < width; ++i, dst += 3) {
+                    const uint32_t p = in[i];
+                    dst[0] = p >> 16;
+                    dst[1] = p >> 8;
+                    dst[2] = p;
+                }
+            } break;
+            case GPU_READ_RGB565: {
+                uint16_t* dst = (uint16_t*) out;
+                for(int i = 0; i < width; ++i) {
+                    const uint32_t p = in[i];
+                    dst[i] = ((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F);
+                }
+            } break;
             default:
-              break;
+                return false;
         }
     }
+
+    return true;
 }
 
 void UploadMatrix4x4(const Matrix4x4* mat) {
@@ -604,20 +1075,24 @@ size_t GPUMemoryAvailable() {
 }
 
 void* GPUMemoryAlloc(size_t size) {
+    /* Keep allocations 32 byte aligned, as on the PVR */
+    size = (size + 31) & ~31;
+
     if(size > AVAILABLE_VRAM) {
         return NULL;
     } else {
+        void* ret = VRAM + (TEXTURE_MEMORY_SIZE - AVAILABLE_VRAM);
         AVAILABLE_VRAM -= size;
-        return malloc(size);
+        return ret;
     }
 }
 
 void GPUSetPaletteFormat(GPUPaletteFormat format) {
-
+    PaletteSetFormat(format);
 }
 
 void GPUSetPaletteEntry(uint32_t idx, uint32_t value) {
-
+    PaletteSetEntry(idx, value);
 }
 
 void GPUSetBackgroundColour(float r, float g, float b) {
@@ -627,27 +1102,51 @@ void GPUSetBackgroundColour(float r, float g, float b) {
 }
 
 void GPUSetAlphaCutOff(uint8_t v) {
-
+    ALPHA_CUTOFF = v;
 }
 
 void GPUSetClearDepth(float v) {
+    CLEAR_DEPTH = v;
+}
 
+void GPUSetThreadCount(uint32_t count) {
+    WorkersInit(count);
 }
 
-void GPUSetFogLinear(float start, float end) {
+void GPUSetTextureCacheSize(size_t bytes) {
+    TextureCacheSetBudget(bytes);
+}
 
+void GPUTextureMemoryChanged(const void* ptr, size_t size) {
+    TextureCacheInvalidate(ptr, size);
 }
 
-void GPUSetFogExp(float density) {
+void GPUSetFogLinear(float start, float end) {
+    FOG_PARAMS.mode = FOG_LINEAR;
+    FOG_PARAMS.start = start;
+    FOG_PARAMS.end = end;
+    FOG_PARAMS.dirty = true;
+}
 
+void GPUSetFogExp(float density) {
+    FOG_PARAMS.mode = FOG_EXP;
+    FOG_PARAMS.density = density;
+    FOG_PARAMS.dirty = true;
 }
 
 void GPUSetFogExp2(float density) {
-
+    FOG_PARAMS.mode = FOG_EXP2;
+    FOG_PARAMS.density = density;
+    FOG_PARAMS.dirty = true;
 }
 
-void GPUSetFogColor(float r, float g, float b, float a) {
-
+void GPUSetFogColor(float a, float r, float g, float b) {
+    /* The colour is a register rather than part of the table, so it
+     * takes effect straight away */
+    FOG.colour = ((uint32_t) (CLAMP(a, 0.0f, 1.0f) * 255.0f) << 24) |
+        ((uint32_t) (CLAMP(r, 0.0f, 1.0f) * 255.0f) << 16) |
+        ((uint32_t) (CLAMP(g, 0.0f, 1.0f) * 255.0f) << 8) |
+        (uint32_t) (CLAMP(b, 0.0f, 1.0f) * 255.0f);
 }
 
 void TransformVec3NoMod(const float* v, float* ret) {
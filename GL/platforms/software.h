@@ -67,8 +67,37 @@ void GPUSetBackgroundColour(float r, float g, float b);
 void GPUSetAlphaCutOff(uint8_t v);
 void GPUSetClearDepth(float v);
 
+/* Copies a rectangle of the last scene rendered, given from the top left
+ * of the framebuffer, into pixels. Rows are written from the bottom of
+ * the rectangle up, stride bytes apart, as glReadPixels returns them.
+ * The rectangle must be within the framebuffer. */
+bool GPUReadPixels(uint16_t x, uint16_t y, uint16_t width, uint16_t height, GPUReadFormat format, size_t stride, void* pixels);
+
+/* Renders the following scenes into a texture in texture memory rather
+ * than the display, until called again with NULL. format is the PVR
+ * texture format, only the 16 bit colour ones can be rendered to.
+ * Returns false if the texture can't be rendered to. */
+bool GPUSetRenderTexture(void* data, uint16_t width, uint16_t height, uint32_t format);
+
+/* Rasterize at 1/divisor of the video mode on each axis (1, 2 or 4),
+ * upscaled when shown. 0 picks the divisor every frame to keep rendering
+ * within the target frame time. */
+void GPUSetResolutionDivisor(uint32_t divisor);
+void GPUSetTargetFrameTime(uint32_t microseconds);
+
+/* Number of threads used to render tiles, 0 means one per CPU */
+void GPUSetThreadCount(uint32_t count);
+
+/* Bytes of decoded textures to keep around for sampling, 0 disables it */
+void GPUSetTextureCacheSize(size_t bytes);
+
+/* Must be called when texture memory is written, so that nothing is
+ * sampled from a stale copy of it */
+void GPUTextureMemoryChanged(const void* ptr, size_t size);
+
 void GPUSetFogLinear(float start, float end);
 void GPUSetFogExp(float density);
 void GPUSetFogExp2(float density);
-void GPUSetFogColor(float r, float g, float b, float a);
+/* Alpha first, like pvr_fog_table_color */
+void GPUSetFogColor(float a, float r, float g, float b);
 
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+/* The software backend rasterizes into an in-memory ARGB8888 colour buffer.
+ * A display is only responsible for getting that buffer in front of the
+ * user, once per frame, from SceneFinish. */
+
+void DisplayInit(uint16_t width, uint16_t height);
+void DisplayPresent(const uint32_t* pixels, uint16_t width, uint16_t height);
+void DisplayShutdown();
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "display.h"
+
+/* Display used by BACKEND=headless. Nothing is shown, frames are simply
+ * counted and optionally written to disk. Behaviour is controlled through
+ * the environment so samples and benchmarks can run unmodified:
+ *
+ *  - GLDC_DUMP_FRAMES: printf-style pattern (e.g. "frame%04d.ppm") receiving
+ *    the frame number. Files ending in ".raw" get the colour buffer as-is
+ *    (ARGB8888, native endian), anything else is written as a binary PPM.
+ *  - GLDC_DUMP_INTERVAL: only dump every Nth frame (default 1)
+ *  - GLDC_FRAME_LIMIT: exit cleanly after this many frames (default 0, run
+ *    forever)
+ */
+
+static const char* DUMP_PATTERN = NULL;
+static unsigned int DUMP_INTERVAL = 1;
+static unsigned int FRAME_LIMIT = 0;
+static unsigned int FRAME_COUNTER = 0;
+
+static unsigned int envToUInt(const char* name, unsigned int fallback) {
+    const char* value = getenv(name);
+    if(!value || !*value) {
+        return fallback;
+    }
+
+    return (unsigned int) strtoul(value, NULL, 10);
+}
+
+static int hasSuffix(const char* str, const char* suffix) {
+    size_t len = strlen(str);
+    size_t slen = strlen(suffix);
+    return len >= slen && strcmp(str + len - slen, suffix) == 0;
+}
+
+static void dumpFrame(const char* path, const uint32_t* pixels, uint16_t width, uint16_t height) {
+    FILE* out = fopen(path, "wb");
+    if(!out) {
+        fprintf(stderr, "GLdc: unable to open %s for writing\n", path);
+        return;
+    }
+
+    if(hasSuffix(path, ".raw")) {
+        fwrite(pixels, sizeof(uint32_t), width * height, out);
+    } else {
+        fprintf(out, "P6\n%d %d\n255\n", width, height);
+
+        uint8_t* row = (uint8_t*) malloc(width * 3);
+        for(uint16_t y = 0; y < height; ++y) {
+            const uint32_t* src = pixels + (y * width);
+            uint8_t* dst = row;
+            for(uint16_t x = 0; x < width; ++x, ++src) {
+                *dst++ = (*src >> 16) & 0xFF;
+                *dst++ = (*src >> 8) & 0xFF;
+                *dst++ = (*src >> 0) & 0xFF;
+            }
+            fwrite(row, 3, width, out);
+        }
+        free(row);
+    }
+
+    fclose(out);
+}
+
+void DisplayInit(uint16_t width, uint16_t height) {
+    (void) width;
+    (void) height;
+
+    DUMP_PATTERN = getenv("GLDC_DUMP_FRAMES");
+    if(DUMP_PATTERN && !*DUMP_PATTERN) {
+        DUMP_PATTERN = NULL;
+    }
+
+    DUMP_INTERVAL = envToUInt("GLDC_DUMP_INTERVAL", 1);
+    if(!DUMP_INTERVAL) {
+        DUMP_INTERVAL = 1;
+    }
+
+    FRAME_LIMIT = envToUInt("GLDC_FRAME_LIMIT", 0);
+    FRAME_COUNTER = 0;
+}
+
+void DisplayPresent(const uint32_t* pixels, uint16_t width, uint16_t height) {
+    if(DUMP_PATTERN && (FRAME_COUNTER % DUMP_INTERVAL) == 0) {
+        char path[1024];
+        snprintf(path, sizeof(path), DUMP_PATTERN, FRAME_COUNTER);
+        dumpFrame(path, pixels, width, height);
+    }
+
+    ++FRAME_COUNTER;
+
+    if(FRAME_LIMIT && FRAME_COUNTER >= FRAME_LIMIT) {
+        DisplayShutdown();
+        exit(0);
+    }
+}
+
+void DisplayShutdown() {
+
+}
@@ -0,0 +1,75 @@
+#include <SDL.h>
+
+#include <stdlib.h>
+
+#include "display.h"
+
+static SDL_Window* WINDOW = NULL;
+static SDL_Renderer* RENDERER = NULL;
+static SDL_Texture* TEXTURE = NULL;
+
+void DisplayInit(uint16_t width, uint16_t height) {
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
+
+    WINDOW = SDL_CreateWindow(
+        "GLdc",
+        SDL_WINDOWPOS_UNDEFINED,
+        SDL_WINDOWPOS_UNDEFINED,
+        width, height,
+        SDL_WINDOW_SHOWN
+    );
+
+    RENDERER = SDL_CreateRenderer(
+        WINDOW, -1, SDL_RENDERER_ACCELERATED
+    );
+
+    /* The whole frame goes up in a single texture upload */
+    TEXTURE = SDL_CreateTexture(
+        RENDERER, SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING, width, height
+    );
+
+    /* The colour buffer keeps alpha for blending, it isn't meant to be
+     * composited with the window */
+    SDL_SetTextureBlendMode(TEXTURE, SDL_BLENDMODE_NONE);
+}
+
+void DisplayPresent(const uint32_t* pixels, uint16_t width, uint16_t height) {
+    (void) height;
+
+    SDL_UpdateTexture(TEXTURE, NULL, pixels, width * sizeof(uint32_t));
+    SDL_RenderCopy(RENDERER, TEXTURE, NULL, NULL);
+    SDL_RenderPresent(RENDERER);
+
+    /* Only sensible place to hook the quit signal */
+    SDL_Event e;
+    while (SDL_PollEvent(&e)) {
+        switch (e.type) {
+            case SDL_QUIT:
+              DisplayShutdown();
+              exit(0);
+              break;
+            default:
+              break;
+        }
+    }
+}
+
+void DisplayShutdown() {
+    if(TEXTURE) {
+        SDL_DestroyTexture(TEXTURE);
+        TEXTURE = NULL;
+    }
+
+    if(RENDERER) {
+        SDL_DestroyRenderer(RENDERER);
+        RENDERER = NULL;
+    }
+
+    if(WINDOW) {
+        SDL_DestroyWindow(WINDOW);
+        WINDOW = NULL;
+    }
+
+    SDL_Quit();
+}
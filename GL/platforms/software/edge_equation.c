@@ -1,20 +1,26 @@
 #include "edge_equation.h"
 
-void EdgeEquationInit(EdgeEquation* edge, const float* v0, const float* v1) {
+void EdgeEquationInit(EdgeEquation* edge, const int32_t* v0, const int32_t* v1) {
     edge->a = v0[1] - v1[1];
     edge->b = v1[0] - v0[0];
-    edge->c = -(edge->a * (v0[0] + v1[0]) + edge->b * (v0[1] + v1[1])) / 2;
-    edge->tie = edge->a != 0 ? edge->a > 0 : edge->b > 0;
-}
+    edge->x = v0[0];
+    edge->y = v0[1];
 
-float EdgeEquationEvaluate(const EdgeEquation* edge, float x, float y) {
-    return edge->a * x + edge->b * y + edge->c;
+    /* The inside is in the direction of (a, b), so with y pointing down a
+     * left edge has a > 0 and a top edge has a == 0 and b > 0 */
+    const bool top_left = edge->a != 0 ? edge->a > 0 : edge->b > 0;
+    edge->bias = (top_left) ? 0 : 1;
 }
 
-bool EdgeEquationTestValue(const EdgeEquation* edge, float value) {
-    return (value >= 0 || (value == 0 && edge->tie));
-}
+void EdgeEquationReverse(EdgeEquation* edge, const EdgeEquation* src) {
+    const int32_t a = src->a;
+    const int32_t b = src->b;
+
+    edge->a = -a;
+    edge->b = -b;
+    edge->x = src->x + b;
+    edge->y = src->y - a;
 
-bool EdgeEquationTestPoint(const EdgeEquation* edge, float x, float y) {
-    return EdgeEquationTestValue(edge, EdgeEquationEvaluate(edge, x, y));
+    /* One way round or the other is top-left, unless there's no edge */
+    edge->bias = (a == 0 && b == 0) ? 1 : 1 - src->bias;
 }
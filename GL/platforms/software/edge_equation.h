@@ -3,15 +3,39 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Vertex positions are snapped to 28.4 fixed point, a 16th of a pixel,
+ * before rasterization */
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+#define SUBPIXEL_HALF (SUBPIXEL_ONE >> 1)
+
+/* Snapped coordinates are kept within this many pixels of the origin, so
+ * that an edge value never changes by more than 2^30 across a block */
+#define SUBPIXEL_GUARD_BAND (1 << 18)
+
+/* An edge function of snapped vertices. Its value at a point is twice the
+ * signed area of the triangle the point makes with the edge, in 1/256ths
+ * of a pixel squared, so it's exact and shared edges give exactly opposite
+ * values.
+ *
+ * Points exactly on an edge belong to the triangle only if it's a top or
+ * left edge, so pixels along a shared edge are drawn once. bias folds
+ * that into the value: a point is inside if value - bias >= 0. */
 typedef struct EdgeEquation {
-    float a;
-    float b;
-    float c;
-    bool tie;
+    int32_t a;      /* Change in value per subpixel step in x */
+    int32_t b;      /* Change in value per subpixel step in y */
+    int32_t x;      /* Start of the edge, in subpixels */
+    int32_t y;
+    int32_t bias;
 } EdgeEquation;
 
-void EdgeEquationInit(EdgeEquation* edge, const float* v0, const float* v1);
-float EdgeEquationEvaluate(const EdgeEquation* edge, float x, float y);
-bool EdgeEquationTestValue(const EdgeEquation* edge, float value);
-bool EdgeEquationTestPoint(const EdgeEquation* edge, float x, float y);
+void EdgeEquationInit(EdgeEquation* edge, const int32_t* v0, const int32_t* v1);
+
+/* The same edge, from v1 to v0 */
+void EdgeEquationReverse(EdgeEquation* edge, const EdgeEquation* src);
 
+/* The biased value at a point in subpixels, >= 0 if the point is on the
+ * inside of the edge */
+static inline int64_t EdgeEquationEvaluate(const EdgeEquation* edge, int32_t x, int32_t y) {
+    return (int64_t) edge->a * (x - edge->x) + (int64_t) edge->b * (y - edge->y) - edge->bias;
+}
@@ -0,0 +1,40 @@
+#include <math.h>
+
+#include "fog_table.h"
+
+/* The distance (w) each entry of the table is for */
+static float EntryDistance(uint32_t i) {
+    const float t = ldexpf(1.0f + (i & 0xF) / 16.0f, i >> 4);
+    return FOG_TABLE_SCALE / t;
+}
+
+/* visibility is how much of the colour is left, as GL works it out */
+static void EntrySet(FogTable* table, uint32_t i, float visibility) {
+    visibility = (visibility < 0.0f) ? 0.0f : (visibility > 1.0f) ? 1.0f : visibility;
+    table->entries[i] = (uint8_t) lrintf((1.0f - visibility) * 255.0f);
+}
+
+void FogTableLinear(FogTable* table, float start, float end) {
+    for(uint32_t i = 0; i < FOG_TABLE_SIZE; ++i) {
+        const float z = EntryDistance(i);
+
+        if(end == start) {
+            EntrySet(table, i, (z < end) ? 1.0f : 0.0f);
+        } else {
+            EntrySet(table, i, (end - z) / (end - start));
+        }
+    }
+}
+
+void FogTableExp(FogTable* table, float density) {
+    for(uint32_t i = 0; i < FOG_TABLE_SIZE; ++i) {
+        EntrySet(table, i, expf(-density * EntryDistance(i)));
+    }
+}
+
+void FogTableExp2(FogTable* table, float density) {
+    for(uint32_t i = 0; i < FOG_TABLE_SIZE; ++i) {
+        const float d = density * EntryDistance(i);
+        EntrySet(table, i, expf(-d * d));
+    }
+}
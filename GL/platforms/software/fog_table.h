@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/* Table fog as the PVR does it: 128 fog amounts looked up by the depth of
+ * a pixel (1/w) rather than worked out per pixel.
+ *
+ * The depth is scaled by FOG_TABLE_SCALE and the index comes from its
+ * floating point representation, 16 entries for each power of two from 1
+ * to 256, so the table has more detail close to the camera. Anything
+ * farther than the first entry uses it, anything nearer than the last
+ * uses that. Neighbouring entries are blended by the rest of the
+ * mantissa. */
+
+#define FOG_TABLE_SIZE 128
+
+/* What KOS sets the fog density register to (0xFF07) */
+#define FOG_TABLE_SCALE 255.0f
+
+typedef struct FogTable {
+    uint8_t entries[FOG_TABLE_SIZE];    /* 0 is no fog, 255 only fog colour */
+    uint32_t colour;                    /* ARGB8888 */
+} FogTable;
+
+void FogTableLinear(FogTable* table, float start, float end);
+void FogTableExp(FogTable* table, float density);
+void FogTableExp2(FogTable* table, float density);
+
+/* The fog amount at a depth, 0 to 256 */
+static inline uint32_t FogTableAmount(const FogTable* table, float invw) {
+    const float t = invw * FOG_TABLE_SCALE;
+
+    if(!(t >= 1.0f)) {
+        return table->entries[0] + (table->entries[0] >> 7);
+    }
+
+    uint32_t bits;
+    memcpy(&bits, &t, sizeof(bits));
+
+    const uint32_t exponent = (bits >> 23) - 127;
+    if(exponent >= 8) {
+        return table->entries[FOG_TABLE_SIZE - 1] + (table->entries[FOG_TABLE_SIZE - 1] >> 7);
+    }
+
+    const uint32_t index = (exponent << 4) | ((bits >> 19) & 0xF);
+    const int32_t fraction = (bits >> 11) & 0xFF;
+
+    const int32_t e0 = table->entries[index];
+    const int32_t e1 = table->entries[(index < FOG_TABLE_SIZE - 1) ? index + 1 : index];
+    const uint32_t amount = e0 + (((e1 - e0) * fraction) >> 8);
+
+    return amount + (amount >> 7);
+}
+
+/* Blends the fog colour into an ARGB8888 colour, leaving its alpha */
+static inline uint32_t FogTableApply(const FogTable* table, uint32_t colour, float invw) {
+    const uint32_t f = FogTableAmount(table, invw);
+    const uint32_t fog = table->colour;
+
+    const uint32_t rb = ((((colour & 0xFF00FF) * (256 - f)) + ((fog & 0xFF00FF) * f)) >> 8) & 0xFF00FF;
+    const uint32_t g = ((((colour & 0xFF00) * (256 - f)) + ((fog & 0xFF00) * f)) >> 8) & 0xFF00;
+
+    return (colour & 0xFF000000) | rb | g;
+}
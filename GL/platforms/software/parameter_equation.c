@@ -1,16 +1,28 @@
 #include "parameter_equation.h"
 #include "edge_equation.h"
 
-void ParameterEquationInit(ParameterEquation* equation, float p0, float p1, float p2, const EdgeEquation* e0, const EdgeEquation* e1, const EdgeEquation* e2, float area) {
+void ParameterGradientsInit(ParameterGradients* gradients, const EdgeEquation* e, int64_t area2) {
+    /* Each vertex is weighted by the edge opposite it, whose value changes
+     * by SUBPIXEL_ONE steps per pixel */
+    const double factor = (double) SUBPIXEL_ONE / (double) area2;
 
-    float factor = 1.0f / (2.0f * area);
-
-    equation->a = factor * (p0 * e0->a + p1 * e1->a + p2 * e2->a);
-    equation->b = factor * (p0 * e0->b + p1 * e1->b + p2 * e2->b);
-    equation->c = factor * (p0 * e0->c + p1 * e1->c + p2 * e2->c);
+    gradients->x0 = (float) e[0].x / SUBPIXEL_ONE;
+    gradients->y0 = (float) e[0].y / SUBPIXEL_ONE;
+    gradients->w1dx = (float) (e[2].a * factor);
+    gradients->w1dy = (float) (e[2].b * factor);
+    gradients->w2dx = (float) (e[0].a * factor);
+    gradients->w2dy = (float) (e[0].b * factor);
 }
 
+void ParameterEquationInit(ParameterEquation* equation, float p0, float p1, float p2, const ParameterGradients* gradients) {
+    /* The weights sum to one, so interpolate relative to p0. That way a
+     * parameter which is the same at every vertex (e.g. the depth of a
+     * flat polygon) comes out exactly constant, which matters for
+     * GPU_DEPTHCMP_EQUAL */
+    const float d1 = p1 - p0;
+    const float d2 = p2 - p0;
 
-float ParameterEquationEvaluate(const ParameterEquation* equation, float x, float y) {
-    return equation->a * x + equation->b * y + equation->c;
+    equation->a = d1 * gradients->w1dx + d2 * gradients->w2dx;
+    equation->b = d1 * gradients->w1dy + d2 * gradients->w2dy;
+    equation->c = p0 - equation->a * gradients->x0 - equation->b * gradients->y0;
 }
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <stdint.h>
+
+/* A value interpolated linearly across the screen, a * x + b * y + c at
+ * pixel (x, y) */
 typedef struct ParameterEquation {
     float a;
     float b;
@@ -8,9 +12,23 @@ typedef struct ParameterEquation {
 
 struct EdgeEquation;
 
-void ParameterEquationInit(
-    ParameterEquation* equation,
-    float p0, float p1, float p2,
-    const struct EdgeEquation* e0, const struct EdgeEquation* e1, const struct EdgeEquation* e2, float area);
+/* Where the first vertex of a triangle is, and how the weights of the
+ * other two change per pixel. Shared by every parameter of the triangle. */
+typedef struct ParameterGradients {
+    float x0;
+    float y0;
+    float w1dx;
+    float w1dy;
+    float w2dx;
+    float w2dy;
+} ParameterGradients;
+
+/* e are the edges v0-v1, v1-v2 and v2-v0, area2 the value of the first
+ * at v2 */
+void ParameterGradientsInit(ParameterGradients* gradients, const struct EdgeEquation* e, int64_t area2);
+
+void ParameterEquationInit(ParameterEquation* equation, float p0, float p1, float p2, const ParameterGradients* gradients);
 
-float ParameterEquationEvaluate(const ParameterEquation* equation, float x, float y);
+static inline float ParameterEquationEvaluate(const ParameterEquation* equation, float x, float y) {
+    return equation->a * x + equation->b * y + equation->c;
+}
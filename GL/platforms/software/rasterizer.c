@@ -0,0 +1,1117 @@
+#include "../../private.h"
+#include "rasterizer.h"
+#include "edge_equation.h"
+#include "parameter_equation.h"
+
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/* Triangles are walked in 4x4 pixel blocks, row by row. Each block is
+ * either rejected or accepted as a whole from the edge values at its
+ * corners, and only blocks straddling an edge test individual pixels. */
+#define BLOCK_SIZE 4
+#define BLOCK_FULL_MASK 0xFFFF
+
+/* Interpolated depth can differ from the bound we compute for a block by
+ * rounding, so hierarchical Z only rejects with a little slack */
+#define HIZ_EPSILON 1e-5f
+
+void RenderTargetInit(RenderTarget* target, uint16_t width, uint16_t height) {
+    const uint32_t count = width * height;
+
+    target->width = width;
+    target->height = height;
+    target->colour = (uint32_t*) malloc(sizeof(uint32_t) * count);
+    target->depth = (float*) malloc(sizeof(float) * count);
+
+    target->hiz_width = (width + HIZ_BLOCK_SIZE - 1) >> HIZ_BLOCK_SHIFT;
+    target->hiz_height = (height + HIZ_BLOCK_SIZE - 1) >> HIZ_BLOCK_SHIFT;
+    target->hiz = (float*) malloc(sizeof(float) * target->hiz_width * target->hiz_height);
+    target->hiz_dirty = (uint8_t*) malloc(target->hiz_width * target->hiz_height);
+}
+
+void RenderTargetResize(RenderTarget* target, uint16_t width, uint16_t height) {
+    target->width = width;
+    target->height = height;
+    target->hiz_width = (width + HIZ_BLOCK_SIZE - 1) >> HIZ_BLOCK_SHIFT;
+    target->hiz_height = (height + HIZ_BLOCK_SIZE - 1) >> HIZ_BLOCK_SHIFT;
+}
+
+void RenderTargetClear(RenderTarget* target, uint32_t colour, float depth) {
+    const uint32_t count = target->width * target->height;
+    for(uint32_t i = 0; i < count; ++i) {
+        target->colour[i] = colour;
+        target->depth[i] = depth;
+    }
+
+    const uint32_t blocks = target->hiz_width * target->hiz_height;
+    for(uint32_t i = 0; i < blocks; ++i) {
+        target->hiz[i] = depth;
+    }
+
+    memset(target->hiz_dirty, 0, blocks);
+}
+
+/* Brings the hierarchical Z of the blocks overlapping the rectangle up to
+ * date, and returns the farthest depth among them */
+static float HiZRefresh(const RenderTarget* target, int minX, int minY, int maxX, int maxY) {
+    float farthest = INFINITY;
+
+    for(int hy = minY >> HIZ_BLOCK_SHIFT; hy <= (maxY >> HIZ_BLOCK_SHIFT); ++hy) {
+        for(int hx = minX >> HIZ_BLOCK_SHIFT; hx <= (maxX >> HIZ_BLOCK_SHIFT); ++hx) {
+            const int idx = hy * target->hiz_width + hx;
+
+            if(target->hiz_dirty[idx]) {
+                const int x0 = hx << HIZ_BLOCK_SHIFT;
+                const int y0 = hy << HIZ_BLOCK_SHIFT;
+                const int x1 = MIN(x0 + HIZ_BLOCK_SIZE, target->width);
+                const int y1 = MIN(y0 + HIZ_BLOCK_SIZE, target->height);
+
+                float value = INFINITY;
+                for(int y = y0; y < y1; ++y) {
+                    const float* row = target->depth + (y * target->width);
+                    for(int x = x0; x < x1; ++x) {
+                        value = MIN(value, row[x]);
+                    }
+                }
+
+                target->hiz[idx] = value;
+                target->hiz_dirty[idx] = 0;
+            }
+
+            farthest = MIN(farthest, target->hiz[idx]);
+        }
+    }
+
+    return farthest;
+}
+
+/* True if nothing with a depth of at most zmax can pass the test against
+ * a region whose farthest depth is farthest */
+GL_FORCE_INLINE bool HiZReject(const GPUDepthCompare func, float zmax, const float farthest) {
+    zmax += fabsf(zmax) * HIZ_EPSILON;
+    return (func == GPU_DEPTHCMP_GREATER) ? zmax <= farthest : zmax < farthest;
+}
+
+/* Hierarchical Z only tracks the farthest depth, so it can only help
+ * when nearer fragments are the ones which pass */
+#define HIZ_SUPPORTED(func) ((func) == GPU_DEPTHCMP_GREATER || (func) == GPU_DEPTHCMP_GEQUAL)
+
+void VertexSnap(const Vertex* v, int32_t* out) {
+    const float limit = SUBPIXEL_GUARD_BAND;
+    const float x = CLAMP(v->xyz[0], -limit, limit) * SUBPIXEL_ONE;
+    const float y = CLAMP(v->xyz[1], -limit, limit) * SUBPIXEL_ONE;
+
+    /* Round to nearest, without a call to lrintf */
+    out[0] = (int32_t) (x + ((x < 0.0f) ? -0.5f : 0.5f));
+    out[1] = (int32_t) (y + ((y < 0.0f) ? -0.5f : 0.5f));
+}
+
+/* The perspective divide leaves 1/w in the depth of a vertex, unless w is
+ * 1 in which case there's no perspective to correct for */
+GL_FORCE_INLINE float VertexInvW(const Vertex* v) {
+    return (v->w == 1.0f) ? 1.0f : v->xyz[2];
+}
+
+void PolyStateInit(PolyState* state, const PolyHeader* header, const uint8_t* texture_memory, const FogTable* fog) {
+    state->culling = (header->mode1 & GPU_TA_PM1_CULLING_MASK) >> GPU_TA_PM1_CULLING_SHIFT;
+    state->depth_func = (header->mode1 & GPU_TA_PM1_DEPTHCMP_MASK) >> GPU_TA_PM1_DEPTHCMP_SHIFT;
+    state->depth_write = ((header->mode1 & GPU_TA_PM1_DEPTHWRITE_MASK) >> GPU_TA_PM1_DEPTHWRITE_SHIFT) == GPU_DEPTHWRITE_ENABLE;
+    state->textured = ((header->mode1 & GPU_TA_PM1_TXRENABLE_MASK) >> GPU_TA_PM1_TXRENABLE_SHIFT) == GPU_TEXTURE_ENABLE;
+
+    if(state->textured) {
+        TextureInit(&state->texture, header, texture_memory);
+    }
+
+    state->alpha = ((header->mode2 & GPU_TA_PM2_ALPHA_MASK) >> GPU_TA_PM2_ALPHA_SHIFT) == GPU_ALPHA_ENABLE;
+    state->punch_through = ((header->cmd & GPU_TA_CMD_TYPE_MASK) >> GPU_TA_CMD_TYPE_SHIFT) == GPU_LIST_PT_POLY;
+    state->alpha_cutoff = 0;
+    state->clip_mode = (header->cmd & GPU_TA_CMD_USERCLIP_MASK) >> GPU_TA_CMD_USERCLIP_SHIFT;
+    state->fog = (((header->mode2 & GPU_TA_PM2_FOG_MASK) >> GPU_TA_PM2_FOG_SHIFT) == GPU_FOG_TABLE) ? fog : NULL;
+
+    state->src_blend = (header->mode2 & GPU_TA_PM2_SRCBLEND_MASK) >> GPU_TA_PM2_SRCBLEND_SHIFT;
+    state->dst_blend = (header->mode2 & GPU_TA_PM2_DSTBLEND_MASK) >> GPU_TA_PM2_DSTBLEND_SHIFT;
+
+    if(state->src_blend == GPU_BLEND_ONE && state->dst_blend == GPU_BLEND_ZERO) {
+        state->blend = BLEND_REPLACE;
+    } else if(state->src_blend == GPU_BLEND_SRCALPHA && state->dst_blend == GPU_BLEND_INVSRCALPHA) {
+        state->blend = BLEND_ALPHA;
+    } else if(state->src_blend == GPU_BLEND_ONE && state->dst_blend == GPU_BLEND_ONE) {
+        state->blend = BLEND_ADD;
+    } else if(state->src_blend == GPU_BLEND_ZERO && state->dst_blend == GPU_BLEND_DESTCOLOR) {
+        state->blend = BLEND_MODULATE;
+    } else {
+        state->blend = BLEND_GENERIC;
+    }
+}
+
+bool TriangleSetup(Triangle* tri, const uint32_t* index, const int32_t (*p)[2], const EdgeEquation* e, const PolyState* state, const RenderTarget* target) {
+    /* The pixels whose centres could be inside the triangle */
+    int minX = (MIN(MIN(p[0][0], p[1][0]), p[2][0]) - SUBPIXEL_HALF + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+    int maxX = (MAX(MAX(p[0][0], p[1][0]), p[2][0]) - SUBPIXEL_HALF) >> SUBPIXEL_BITS;
+    int minY = (MIN(MIN(p[0][1], p[1][1]), p[2][1]) - SUBPIXEL_HALF + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+    int maxY = (MAX(MAX(p[0][1], p[1][1]), p[2][1]) - SUBPIXEL_HALF) >> SUBPIXEL_BITS;
+
+    // Clip to the render target.
+
+    minX = MAX(minX, 0);
+    maxX = MIN(maxX, target->width - 1);
+    minY = MAX(minY, 0);
+    maxY = MIN(maxY, target->height - 1);
+
+    if(state->clip_mode == GPU_USERCLIP_INSIDE) {
+        minX = MAX(minX, state->clip.left);
+        maxX = MIN(maxX, state->clip.right);
+        minY = MAX(minY, state->clip.top);
+        maxY = MIN(maxY, state->clip.bottom);
+    }
+
+    if(minX > maxX || minY > maxY) {
+        return false;
+    }
+
+    /* Twice the signed area, in subpixels squared */
+    const int64_t area = (int64_t) e[0].a * (p[2][0] - p[0][0]) + (int64_t) e[0].b * (p[2][1] - p[0][1]);
+
+    if(area == 0) {
+        return false;
+    }
+
+    /* Check if the triangle is backfacing. Rasterization always happens
+     * with a positive area, so anything we keep which is backfacing has
+     * its first two vertices swapped, which turns its edges around */
+    if(state->culling == GPU_CULLING_CCW) {
+        if(area < 0) {
+            return false;
+        }
+    } else if(state->culling == GPU_CULLING_CW) {
+        if(area > 0) {
+            return false;
+        }
+    }
+
+    if(area < 0) {
+        tri->v[0] = index[1];
+        tri->v[1] = index[0];
+        tri->v[2] = index[2];
+        EdgeEquationReverse(&tri->e[0], &e[0]);
+        EdgeEquationReverse(&tri->e[1], &e[2]);
+        EdgeEquationReverse(&tri->e[2], &e[1]);
+        tri->area2 = -area;
+    } else {
+        tri->v[0] = index[0];
+        tri->v[1] = index[1];
+        tri->v[2] = index[2];
+        tri->e[0] = e[0];
+        tri->e[1] = e[1];
+        tri->e[2] = e[2];
+        tri->area2 = area;
+    }
+
+    tri->bounds.left = minX;
+    tri->bounds.top = minY;
+    tri->bounds.right = maxX;
+    tri->bounds.bottom = maxY;
+
+    return true;
+}
+
+typedef struct {
+    const EdgeEquation* e;
+    int32_t step_x[3];      /* Change in each edge value per pixel */
+    int32_t step_y[3];
+    int32_t reach_min[3];
+    int32_t reach_max[3];
+    float z_reach_max;
+    int minX, minY, maxX, maxY;
+
+    /* For the first pass of deferred shading, the id buffer the winning
+     * triangle is written to instead of shading it. NULL otherwise. */
+    uint32_t* ids;
+    uint32_t id;
+    int ids_stride;
+    int ids_left;
+    int ids_top;
+
+    /* For autosorted translucent polygons, where fragments are collected
+     * instead of being blended straight away. NULL otherwise. */
+    FragmentBuffer* fragments;
+    uint32_t state;
+
+    /* The user clip rectangle of polygons drawn outside of it, whose pixels
+     * are masked out. NULL otherwise. */
+    const Rect* excluded;
+} BlockWalk;
+
+/* The edge values of a block that isn't rejected, narrowed to 32 bits for
+ * stepping. Edges the block straddles are within a block's reach of zero,
+ * but ones which accept the whole block can be far bigger (the guard band
+ * is 2^18 pixels) so they're clamped to a value which still accepts it. */
+GL_FORCE_INLINE void BlockEdgeValues(const BlockWalk* walk, const int64_t* v, int32_t* out) {
+    for(int i = 0; i < 3; ++i) {
+        const int64_t limit = INT32_MAX - walk->reach_max[i];
+        out[i] = (int32_t) ((v[i] > limit) ? limit : v[i]);
+    }
+}
+
+/* Returns a 16 bit mask of the pixels of the 4x4 block whose top-left
+ * pixel centre has the edge values v, bit (y * 4 + x) per pixel. Only
+ * blocks an edge passes through get here. */
+#ifdef __SSE2__
+GL_FORCE_INLINE uint32_t BlockCoverage(const BlockWalk* walk, const int64_t* v) {
+    const int32_t* sx = walk->step_x;
+    const __m128i outside = _mm_set1_epi32(-1);
+
+    int32_t e[3];
+    BlockEdgeValues(walk, v, e);
+
+    __m128i row0 = _mm_add_epi32(_mm_set1_epi32(e[0]), _mm_setr_epi32(0, sx[0], sx[0] * 2, sx[0] * 3));
+    __m128i row1 = _mm_add_epi32(_mm_set1_epi32(e[1]), _mm_setr_epi32(0, sx[1], sx[1] * 2, sx[1] * 3));
+    __m128i row2 = _mm_add_epi32(_mm_set1_epi32(e[2]), _mm_setr_epi32(0, sx[2], sx[2] * 2, sx[2] * 3));
+
+    const __m128i step0 = _mm_set1_epi32(walk->step_y[0]);
+    const __m128i step1 = _mm_set1_epi32(walk->step_y[1]);
+    const __m128i step2 = _mm_set1_epi32(walk->step_y[2]);
+
+    uint32_t mask = 0;
+    for(int y = 0; y < BLOCK_SIZE; ++y) {
+        __m128i inside = _mm_and_si128(
+            _mm_and_si128(_mm_cmpgt_epi32(row0, outside), _mm_cmpgt_epi32(row1, outside)),
+            _mm_cmpgt_epi32(row2, outside)
+        );
+
+        mask |= _mm_movemask_ps(_mm_castsi128_ps(inside)) << (y * BLOCK_SIZE);
+
+        row0 = _mm_add_epi32(row0, step0);
+        row1 = _mm_add_epi32(row1, step1);
+        row2 = _mm_add_epi32(row2, step2);
+    }
+
+    return mask;
+}
+#else
+GL_FORCE_INLINE uint32_t BlockCoverage(const BlockWalk* walk, const int64_t* v) {
+    uint32_t mask = 0;
+    int32_t row[3];
+    BlockEdgeValues(walk, v, row);
+
+    for(int y = 0; y < BLOCK_SIZE; ++y) {
+        int32_t x0 = row[0], x1 = row[1], x2 = row[2];
+        for(int x = 0; x < BLOCK_SIZE; ++x) {
+            if(x0 >= 0 && x1 >= 0 && x2 >= 0) {
+                mask |= 1 << (y * BLOCK_SIZE + x);
+            }
+
+            x0 += walk->step_x[0];
+            x1 += walk->step_x[1];
+            x2 += walk->step_x[2];
+        }
+
+        row[0] += walk->step_y[0];
+        row[1] += walk->step_y[1];
+        row[2] += walk->step_y[2];
+    }
+
+    return mask;
+}
+#endif
+
+/* Mask of the block columns (replicated to each row) which fall within
+ * [minX, maxX] for a block starting at bx */
+GL_FORCE_INLINE uint32_t ColumnMask(int bx, int minX, int maxX) {
+    uint32_t cols = 0xF;
+    if(bx < minX) {
+        cols &= 0xF << (minX - bx);
+    }
+
+    if(bx + BLOCK_SIZE - 1 > maxX) {
+        cols &= 0xF >> (bx + BLOCK_SIZE - 1 - maxX);
+    }
+
+    return cols * 0x1111;
+}
+
+GL_FORCE_INLINE uint32_t RowMask(int by, int minY, int maxY) {
+    uint32_t rows = 0xF;
+    if(by < minY) {
+        rows &= 0xF << (minY - by);
+    }
+
+    if(by + BLOCK_SIZE - 1 > maxY) {
+        rows &= 0xF >> (by + BLOCK_SIZE - 1 - maxY);
+    }
+
+    return ((rows & 1) ? 0x000F : 0) |
+           ((rows & 2) ? 0x00F0 : 0) |
+           ((rows & 4) ? 0x0F00 : 0) |
+           ((rows & 8) ? 0xF000 : 0);
+}
+
+/* Mask of the pixels of the block at bx, by which are inside rect */
+GL_FORCE_INLINE uint32_t RectMask(int bx, int by, const Rect* rect) {
+    if(bx > rect->right || bx + BLOCK_SIZE - 1 < rect->left ||
+        by > rect->bottom || by + BLOCK_SIZE - 1 < rect->top) {
+        return 0;
+    }
+
+    return RowMask(by, rect->top, rect->bottom) & ColumnMask(bx, rect->left, rect->right);
+}
+
+/* Colour and texture coordinates are interpolated divided by w, along
+ * with 1/w itself, so that they're perspective correct. When w is the
+ * same at every vertex that's skipped and they're interpolated as is. */
+typedef struct {
+    ParameterEquation z;
+    ParameterEquation q;
+    ParameterEquation r, g, b, a;
+    ParameterEquation u, v;
+    bool perspective;
+} Interpolants;
+
+/* Fills in the value of an interpolant at every pixel centre of a block,
+ * stepping across from the first one rather than evaluating each */
+GL_FORCE_INLINE void BlockInterpolate(const ParameterEquation* equation, float x, float y, float* out) {
+    float row = ParameterEquationEvaluate(equation, x, y);
+
+    for(int py = 0; py < BLOCK_SIZE; ++py, row += equation->b) {
+        float value = row;
+        for(int px = 0; px < BLOCK_SIZE; ++px, value += equation->a) {
+            out[py * BLOCK_SIZE + px] = value;
+        }
+    }
+}
+
+/* Depth is 1/w, so larger values are nearer. The comparison is between
+ * the incoming value and what's in the buffer, as on the PVR */
+GL_FORCE_INLINE bool DepthTest(const GPUDepthCompare func, const float z, const float d) {
+    switch(func) {
+        case GPU_DEPTHCMP_NEVER: return false;
+        case GPU_DEPTHCMP_LESS: return z < d;
+        case GPU_DEPTHCMP_EQUAL: return z == d;
+        case GPU_DEPTHCMP_LEQUAL: return z <= d;
+        case GPU_DEPTHCMP_GREATER: return z > d;
+        case GPU_DEPTHCMP_NOTEQUAL: return z != d;
+        case GPU_DEPTHCMP_GEQUAL: return z >= d;
+        case GPU_DEPTHCMP_ALWAYS:
+        default:
+            return true;
+    }
+}
+
+/* (x * y) / 255 for 8 bit channels, exact at both ends */
+GL_FORCE_INLINE uint32_t Mul8(uint32_t x, uint32_t y) {
+    return (x * y + 255) >> 8;
+}
+
+/* Combines a texel with the shaded colour the way the PVR does for each
+ * texture environment, returning ARGB8888 */
+GL_FORCE_INLINE uint32_t TextureEnv(const Texture* tex, uint32_t texel, uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+    const uint32_t ta = (tex->alpha) ? (texel >> 24) : 0xFF;
+    const uint32_t tr = (texel >> 16) & 0xFF;
+    const uint32_t tg = (texel >> 8) & 0xFF;
+    const uint32_t tb = texel & 0xFF;
+
+    switch(tex->env) {
+        case GPU_TXRENV_REPLACE:
+            return (ta << 24) | (texel & 0xFFFFFF);
+        case GPU_TXRENV_MODULATE:
+            return (ta << 24) | (Mul8(tr, r) << 16) | (Mul8(tg, g) << 8) | Mul8(tb, b);
+        case GPU_TXRENV_DECAL:
+            return (a << 24) |
+                ((Mul8(tr, ta) + Mul8(r, 255 - ta)) << 16) |
+                ((Mul8(tg, ta) + Mul8(g, 255 - ta)) << 8) |
+                (Mul8(tb, ta) + Mul8(b, 255 - ta));
+        case GPU_TXRENV_MODULATEALPHA:
+        default:
+            return (Mul8(ta, a) << 24) | (Mul8(tr, r) << 16) | (Mul8(tg, g) << 8) | Mul8(tb, b);
+    }
+}
+
+/* Depth tests the covered pixels of a block, returning the ones which
+ * pass. The depth of every pixel is left in z. */
+GL_FORCE_INLINE uint32_t DepthTestBlock(const RenderTarget* target, const Interpolants* in, const GPUDepthCompare depth_func, int bx, int by, uint32_t mask, float* z) {
+    const float* depth = target->depth + (by * target->width) + bx;
+    uint32_t passed = 0;
+
+    BlockInterpolate(&in->z, bx + 0.5f, by + 0.5f, z);
+
+    while(mask) {
+        const int bit = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        const int px = bit & (BLOCK_SIZE - 1);
+        const int py = bit / BLOCK_SIZE;
+
+        if(DepthTest(depth_func, z[bit], depth[py * target->width + px])) {
+            passed |= 1 << bit;
+        }
+    }
+
+    return passed;
+}
+
+GL_FORCE_INLINE void DepthWriteBlock(const RenderTarget* target, int bx, int by, uint32_t mask, const float* z) {
+    float* depth = target->depth + (by * target->width) + bx;
+
+    while(mask) {
+        const int bit = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        depth[(bit / BLOCK_SIZE) * target->width + (bit & (BLOCK_SIZE - 1))] = z[bit];
+    }
+}
+
+/* Works out the ARGB8888 colour of each pixel in the mask, before
+ * blending, fog included */
+static void ShadeBlock(const Interpolants* in, const PolyState* state, const TextureLevel* level, int bx, int by, uint32_t mask, uint32_t* colour) {
+    const float x = bx + 0.5f;
+    const float y = by + 0.5f;
+
+    float w[BLOCK_SIZE * BLOCK_SIZE];
+    float r[BLOCK_SIZE * BLOCK_SIZE], g[BLOCK_SIZE * BLOCK_SIZE], b[BLOCK_SIZE * BLOCK_SIZE], a[BLOCK_SIZE * BLOCK_SIZE];
+    float u[BLOCK_SIZE * BLOCK_SIZE], v[BLOCK_SIZE * BLOCK_SIZE];
+    float z[BLOCK_SIZE * BLOCK_SIZE];
+
+    if(in->perspective) {
+        BlockInterpolate(&in->q, x, y, w);
+        for(int i = 0; i < BLOCK_SIZE * BLOCK_SIZE; ++i) {
+            w[i] = 1.0f / w[i];
+        }
+    }
+
+    BlockInterpolate(&in->r, x, y, r);
+    BlockInterpolate(&in->g, x, y, g);
+    BlockInterpolate(&in->b, x, y, b);
+
+    if(state->alpha) {
+        BlockInterpolate(&in->a, x, y, a);
+    }
+
+    if(state->textured) {
+        BlockInterpolate(&in->u, x, y, u);
+        BlockInterpolate(&in->v, x, y, v);
+    }
+
+    if(state->fog) {
+        BlockInterpolate(&in->z, x, y, z);
+    }
+
+    while(mask) {
+        const int bit = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        const float pw = (in->perspective) ? w[bit] : 1.0f;
+
+        /* Interpolation can overshoot at the edges of a triangle, so clamp
+         * rather than letting the channel wrap */
+        const uint32_t rint = CLAMP(r[bit] * pw, 0.0f, 255.0f);
+        const uint32_t gint = CLAMP(g[bit] * pw, 0.0f, 255.0f);
+        const uint32_t bint = CLAMP(b[bit] * pw, 0.0f, 255.0f);
+        const uint32_t aint = (state->alpha) ? CLAMP(a[bit] * pw, 0.0f, 255.0f) : 0xFF;
+
+        if(state->textured) {
+            const uint32_t texel = TextureSample(&state->texture, level, u[bit] * pw, v[bit] * pw);
+
+            colour[bit] = TextureEnv(&state->texture, texel, rint, gint, bint, aint);
+        } else {
+            colour[bit] = (aint << 24) | (rint << 16) | (gint << 8) | bint;
+        }
+
+        if(state->fog) {
+            colour[bit] = FogTableApply(state->fog, colour[bit], z[bit]);
+        }
+    }
+}
+
+/* Punch-through fragments are kept if their alpha reaches the cut-off */
+GL_FORCE_INLINE uint32_t AlphaTestBlock(const uint32_t* colour, uint32_t mask, uint8_t cutoff) {
+    uint32_t passed = mask;
+
+    while(mask) {
+        const int bit = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        if((colour[bit] >> 24) < cutoff) {
+            passed &= ~(1 << bit);
+        }
+    }
+
+    return passed;
+}
+
+/* (s * f + d * (256 - f)) >> 8 on all four channels, f is 0-256 */
+GL_FORCE_INLINE uint32_t Lerp8888(uint32_t d, uint32_t s, uint32_t f) {
+    const uint32_t rb = ((((s & 0x00FF00FF) * f) + ((d & 0x00FF00FF) * (256 - f))) >> 8) & 0x00FF00FF;
+    const uint32_t ag = ((((s >> 8) & 0x00FF00FF) * f) + (((d >> 8) & 0x00FF00FF) * (256 - f))) & 0xFF00FF00;
+    return rb | ag;
+}
+
+GL_FORCE_INLINE uint32_t AddSaturate8888(uint32_t a, uint32_t b) {
+    uint32_t rb = (a & 0x00FF00FF) + (b & 0x00FF00FF);
+    uint32_t ag = ((a >> 8) & 0x00FF00FF) + ((b >> 8) & 0x00FF00FF);
+
+    /* Turn the carry out of each channel into 0xFF */
+    const uint32_t rbc = rb & 0x01000100;
+    const uint32_t agc = ag & 0x01000100;
+    rb = (rb | (rbc - (rbc >> 8))) & 0x00FF00FF;
+    ag = (ag | (agc - (agc >> 8))) & 0x00FF00FF;
+
+    return rb | (ag << 8);
+}
+
+GL_FORCE_INLINE uint32_t Mul8888(uint32_t a, uint32_t b) {
+    return (Mul8(a >> 24, b >> 24) << 24) |
+        (Mul8((a >> 16) & 0xFF, (b >> 16) & 0xFF) << 16) |
+        (Mul8((a >> 8) & 0xFF, (b >> 8) & 0xFF) << 8) |
+        Mul8(a & 0xFF, b & 0xFF);
+}
+
+/* The per channel factor for one side of the blend. "Other" is the
+ * destination colour for the source factor, and the source colour for the
+ * destination one, as on the PVR */
+GL_FORCE_INLINE uint32_t BlendFactor(GPUBlend factor, uint32_t other, uint32_t src, uint32_t dst) {
+    switch(factor) {
+        case GPU_BLEND_ZERO: return 0;
+        case GPU_BLEND_ONE: return 0xFFFFFFFF;
+        case GPU_BLEND_DESTCOLOR: return other;
+        case GPU_BLEND_INVDESTCOLOR: return ~other;
+        case GPU_BLEND_SRCALPHA: return (src >> 24) * 0x01010101;
+        case GPU_BLEND_INVSRCALPHA: return (255 - (src >> 24)) * 0x01010101;
+        case GPU_BLEND_DESTALPHA: return (dst >> 24) * 0x01010101;
+        case GPU_BLEND_INVDESTALPHA:
+        default:
+            return (255 - (dst >> 24)) * 0x01010101;
+    }
+}
+
+static uint32_t BlendGeneric(GPUBlend src_blend, GPUBlend dst_blend, uint32_t src, uint32_t dst) {
+    const uint32_t sf = BlendFactor(src_blend, dst, src, dst);
+    const uint32_t df = BlendFactor(dst_blend, src, src, dst);
+    return AddSaturate8888(Mul8888(src, sf), Mul8888(dst, df));
+}
+
+#ifdef __SSE2__
+/* Blends a full row of the block by source alpha, the same arithmetic as
+ * Lerp8888 four pixels at a time */
+GL_FORCE_INLINE void BlendAlphaRow(uint32_t* row, const uint32_t* colour) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i s = _mm_loadu_si128((const __m128i*) colour);
+    const __m128i d = _mm_loadu_si128((const __m128i*) row);
+    const __m128i one = _mm_set1_epi16(256);
+
+    __m128i out[2];
+    for(int i = 0; i < 2; ++i) {
+        const __m128i s16 = (i) ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero);
+        const __m128i d16 = (i) ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero);
+
+        /* Alpha is the last channel of each pixel, spread it over all four
+         * and map 0-255 to 0-256 */
+        __m128i f = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s16, 0xFF), 0xFF);
+        f = _mm_add_epi16(f, _mm_srli_epi16(f, 7));
+
+        const __m128i sum = _mm_add_epi16(_mm_mullo_epi16(s16, f), _mm_mullo_epi16(d16, _mm_sub_epi16(one, f)));
+        out[i] = _mm_srli_epi16(sum, 8);
+    }
+
+    _mm_storeu_si128((__m128i*) row, _mm_packus_epi16(out[0], out[1]));
+}
+#endif
+
+/* Combines one shaded pixel with the colour buffer */
+GL_FORCE_INLINE uint32_t BlendPixel(const PolyState* state, uint32_t src, uint32_t dst) {
+    switch(state->blend) {
+        case BLEND_REPLACE:
+            return src;
+        case BLEND_ALPHA:
+            return Lerp8888(dst, src, (src >> 24) + (src >> 31));
+        case BLEND_ADD:
+            return AddSaturate8888(src, dst);
+        case BLEND_MODULATE:
+            return Mul8888(src, dst);
+        case BLEND_GENERIC:
+        default:
+            return BlendGeneric(state->src_blend, state->dst_blend, src, dst);
+    }
+}
+
+/* Combines the shaded pixels in the mask with the colour buffer */
+static void BlendBlock(const RenderTarget* target, const PolyState* state, int bx, int by, uint32_t mask, const uint32_t* colour) {
+    uint32_t* block = target->colour + (by * target->width) + bx;
+
+#ifdef __SSE2__
+    if(state->blend == BLEND_ALPHA) {
+        for(int py = 0; py < BLOCK_SIZE; ++py) {
+            const uint32_t row = 0xF << (py * BLOCK_SIZE);
+            if((mask & row) == row) {
+                BlendAlphaRow(block + py * target->width, colour + py * BLOCK_SIZE);
+                mask &= ~row;
+            }
+        }
+    }
+#endif
+
+#define FOR_EACH_PIXEL(expr) \
+    while(mask) { \
+        const int bit = __builtin_ctz(mask); \
+        mask &= mask - 1; \
+        uint32_t* dst = block + (bit / BLOCK_SIZE) * target->width + (bit & (BLOCK_SIZE - 1)); \
+        const uint32_t src = colour[bit]; \
+        *dst = (expr); \
+    }
+
+    switch(state->blend) {
+        case BLEND_REPLACE:
+            FOR_EACH_PIXEL(src);
+        break;
+        case BLEND_ALPHA:
+            FOR_EACH_PIXEL(Lerp8888(*dst, src, (src >> 24) + (src >> 31)));
+        break;
+        case BLEND_ADD:
+            FOR_EACH_PIXEL(AddSaturate8888(src, *dst));
+        break;
+        case BLEND_MODULATE:
+            FOR_EACH_PIXEL(Mul8888(src, *dst));
+        break;
+        case BLEND_GENERIC:
+        default:
+            FOR_EACH_PIXEL(BlendGeneric(state->src_blend, state->dst_blend, src, *dst));
+    }
+
+#undef FOR_EACH_PIXEL
+}
+
+GL_FORCE_INLINE void IdWriteBlock(const BlockWalk* walk, int bx, int by, uint32_t mask) {
+    uint32_t* ids = walk->ids + (by - walk->ids_top) * walk->ids_stride + (bx - walk->ids_left);
+
+    while(mask) {
+        const int bit = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        ids[(bit / BLOCK_SIZE) * walk->ids_stride + (bit & (BLOCK_SIZE - 1))] = walk->id;
+    }
+}
+
+static void FragmentAppendBlock(const BlockWalk* walk, int bx, int by, uint32_t mask, const float* z, const uint32_t* colour) {
+    FragmentBuffer* buffer = walk->fragments;
+    const int first = (by - buffer->rect.top) * buffer->width + (bx - buffer->rect.left);
+
+    while(mask) {
+        const int bit = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        const int pixel = first + (bit / BLOCK_SIZE) * buffer->width + (bit & (BLOCK_SIZE - 1));
+
+        if(buffer->count == buffer->capacity || buffer->counts[pixel] == FRAGMENTS_PER_PIXEL_MAX) {
+            buffer->overflow = true;
+            return;
+        }
+
+        Fragment* fragment = &buffer->fragments[buffer->count];
+        fragment->z = z[bit];
+        fragment->colour = colour[bit];
+        fragment->state = walk->state;
+        fragment->next = buffer->heads[pixel];
+
+        buffer->heads[pixel] = buffer->count++;
+        buffer->counts[pixel]++;
+    }
+}
+
+/* Walks the blocks covered by the triangle, row by row. This is inlined
+ * once per depth function so the per-pixel test is a single compare. */
+GL_FORCE_INLINE void RasterizeBlocks(const RenderTarget* target, const BlockWalk* walk, const Interpolants* in, const PolyState* state, const TextureLevel* level, const GPUDepthCompare depth_func, const bool depth_write) {
+    const EdgeEquation* e = walk->e;
+    const int bx0 = walk->minX & ~(BLOCK_SIZE - 1);
+    const int by0 = walk->minY & ~(BLOCK_SIZE - 1);
+
+    for(int by = by0; by <= walk->maxY; by += BLOCK_SIZE) {
+        const uint32_t row_mask = RowMask(by, walk->minY, walk->maxY);
+
+        /* Edge values at the first pixel centre of the first block in
+         * this row, stepped along by a block at a time */
+        int64_t v[3];
+        for(int i = 0; i < 3; ++i) {
+            v[i] = EdgeEquationEvaluate(
+                &e[i],
+                (bx0 << SUBPIXEL_BITS) + SUBPIXEL_HALF,
+                (by << SUBPIXEL_BITS) + SUBPIXEL_HALF
+            );
+        }
+
+        for(int bx = bx0; bx <= walk->maxX; bx += BLOCK_SIZE) {
+            bool reject = false;
+            bool accept = true;
+
+            for(int i = 0; i < 3; ++i) {
+                reject |= (v[i] + walk->reach_max[i]) < 0;
+                accept &= (v[i] + walk->reach_min[i]) >= 0;
+            }
+
+            if(!reject && HIZ_SUPPORTED(depth_func)) {
+                /* Skip the block if the nearest point of the triangle
+                 * within it is behind everything in its 8x8 block */
+                const float zmax = ParameterEquationEvaluate(&in->z, bx + 0.5f, by + 0.5f) + walk->z_reach_max;
+                const int hiz = (by >> HIZ_BLOCK_SHIFT) * target->hiz_width + (bx >> HIZ_BLOCK_SHIFT);
+                reject = HiZReject(depth_func, zmax, target->hiz[hiz]);
+            }
+
+            if(!reject) {
+                uint32_t mask = (accept) ? BLOCK_FULL_MASK : BlockCoverage(walk, v);
+                mask &= row_mask & ColumnMask(bx, walk->minX, walk->maxX);
+
+                if(walk->excluded) {
+                    mask &= ~RectMask(bx, by, walk->excluded);
+                }
+
+                float z[BLOCK_SIZE * BLOCK_SIZE];
+                mask = (mask) ? DepthTestBlock(target, in, depth_func, bx, by, mask, z) : 0;
+
+                if(mask && walk->ids) {
+                    if(depth_write) {
+                        DepthWriteBlock(target, bx, by, mask, z);
+                        target->hiz_dirty[(by >> HIZ_BLOCK_SHIFT) * target->hiz_width + (bx >> HIZ_BLOCK_SHIFT)] = 1;
+                    }
+
+                    IdWriteBlock(walk, bx, by, mask);
+                } else if(mask && walk->fragments) {
+                    uint32_t colour[BLOCK_SIZE * BLOCK_SIZE];
+                    ShadeBlock(in, state, level, bx, by, mask, colour);
+                    FragmentAppendBlock(walk, bx, by, mask, z, colour);
+
+                    if(walk->fragments->overflow) {
+                        return;
+                    }
+                } else if(mask) {
+                    uint32_t colour[BLOCK_SIZE * BLOCK_SIZE];
+                    ShadeBlock(in, state, level, bx, by, mask, colour);
+
+                    if(state->punch_through) {
+                        mask = AlphaTestBlock(colour, mask, state->alpha_cutoff);
+                    }
+
+                    if(depth_write && mask) {
+                        DepthWriteBlock(target, bx, by, mask, z);
+                        target->hiz_dirty[(by >> HIZ_BLOCK_SHIFT) * target->hiz_width + (bx >> HIZ_BLOCK_SHIFT)] = 1;
+                    }
+
+                    BlendBlock(target, state, bx, by, mask, colour);
+                }
+            }
+
+            for(int i = 0; i < 3; ++i) {
+                v[i] += walk->step_x[i] * BLOCK_SIZE;
+            }
+        }
+    }
+}
+
+/* Clamps the walk to the part of the triangle within the clip rectangle,
+ * returning false if there's nothing left */
+static bool BlockWalkBounds(BlockWalk* walk, const Triangle* tri, const Rect* clip) {
+    walk->minX = MAX(tri->bounds.left, clip->left);
+    walk->maxX = MIN(tri->bounds.right, clip->right);
+    walk->minY = MAX(tri->bounds.top, clip->top);
+    walk->maxY = MIN(tri->bounds.bottom, clip->bottom);
+
+    return walk->minX <= walk->maxX && walk->minY <= walk->maxY;
+}
+
+/* Sets up depth, and when level isn't NULL everything shading needs too */
+static void InterpolantsInit(Interpolants* in, TextureLevel* level, const Triangle* tri, const Vertex* vertices, const PolyState* state) {
+    const Vertex* v0 = &vertices[tri->v[0]];
+    const Vertex* v1 = &vertices[tri->v[1]];
+    const Vertex* v2 = &vertices[tri->v[2]];
+
+    ParameterGradients gradients;
+    ParameterGradientsInit(&gradients, tri->e, tri->area2);
+
+    ParameterEquationInit(&in->z, v0->xyz[2], v1->xyz[2], v2->xyz[2], &gradients);
+
+    if(!level) {
+        return;
+    }
+
+    float q0 = VertexInvW(v0);
+    float q1 = VertexInvW(v1);
+    float q2 = VertexInvW(v2);
+
+    in->perspective = !(q0 == q1 && q1 == q2);
+
+    if(in->perspective) {
+        ParameterEquationInit(&in->q, q0, q1, q2, &gradients);
+    } else {
+        q0 = q1 = q2 = 1.0f;
+    }
+
+    ParameterEquationInit(&in->r, v0->bgra[2] * q0, v1->bgra[2] * q1, v2->bgra[2] * q2, &gradients);
+    ParameterEquationInit(&in->g, v0->bgra[1] * q0, v1->bgra[1] * q1, v2->bgra[1] * q2, &gradients);
+    ParameterEquationInit(&in->b, v0->bgra[0] * q0, v1->bgra[0] * q1, v2->bgra[0] * q2, &gradients);
+
+    if(state->alpha) {
+        ParameterEquationInit(&in->a, v0->bgra[3] * q0, v1->bgra[3] * q1, v2->bgra[3] * q2, &gradients);
+    }
+
+    if(state->textured) {
+        const Texture* tex = &state->texture;
+
+        ParameterEquationInit(&in->u, v0->uv[0] * q0, v1->uv[0] * q1, v2->uv[0] * q2, &gradients);
+        ParameterEquationInit(&in->v, v0->uv[1] * q0, v1->uv[1] * q1, v2->uv[1] * q2, &gradients);
+
+        /* One mipmap level for the whole triangle, from how many texels
+         * it covers per pixel */
+        const float area = tri->area2 * (0.5f / (SUBPIXEL_ONE * SUBPIXEL_ONE));
+        const float du1 = v1->uv[0] - v0->uv[0], dv1 = v1->uv[1] - v0->uv[1];
+        const float du2 = v2->uv[0] - v0->uv[0], dv2 = v2->uv[1] - v0->uv[1];
+        const float texels = 0.5f * fabsf(du1 * dv2 - du2 * dv1) * tex->width * tex->height;
+
+        TextureSelectLevel(tex, texels / area, level);
+    }
+}
+
+/* Depth tests the triangle within the clip rectangle, and then either
+ * shades and blends what passes or, if the walk has an id buffer, just
+ * records the triangle there */
+static void RasterizeWalk(const RenderTarget* target, BlockWalk* walk, const Triangle* tri, const Vertex* vertices, const PolyState* state) {
+    const EdgeEquation* e = tri->e;
+    walk->e = e;
+    walk->excluded = (state->clip_mode == GPU_USERCLIP_OUTSIDE) ? &state->clip : NULL;
+
+    Interpolants in;
+    TextureLevel level;
+    InterpolantsInit(&in, (walk->ids) ? NULL : &level, tri, vertices, state);
+
+    /* How far each edge value can move across a block from its
+     * top-left pixel, used to accept or reject whole blocks */
+    for(int i = 0; i < 3; ++i) {
+        walk->step_x[i] = e[i].a * SUBPIXEL_ONE;
+        walk->step_y[i] = e[i].b * SUBPIXEL_ONE;
+
+        const int32_t dx = walk->step_x[i] * (BLOCK_SIZE - 1);
+        const int32_t dy = walk->step_y[i] * (BLOCK_SIZE - 1);
+        walk->reach_max[i] = MAX(dx, 0) + MAX(dy, 0);
+        walk->reach_min[i] = MIN(dx, 0) + MIN(dy, 0);
+    }
+
+    walk->z_reach_max = MAX(in.z.a * (BLOCK_SIZE - 1), 0.0f) + MAX(in.z.b * (BLOCK_SIZE - 1), 0.0f);
+
+    if(HIZ_SUPPORTED(state->depth_func)) {
+        /* Coarse test first: if the nearest point of the triangle is behind
+         * the farthest depth in the area of the tile it covers, the whole
+         * thing is hidden. Nearest is the nearest vertex, or the nearest
+         * corner of the area if that's tighter. */
+        const float farthest = HiZRefresh(target, walk->minX, walk->minY, walk->maxX, walk->maxY);
+
+        float zmax = MAX(MAX(vertices[tri->v[0]].xyz[2], vertices[tri->v[1]].xyz[2]), vertices[tri->v[2]].xyz[2]);
+        const float zcorner = ParameterEquationEvaluate(&in.z, walk->minX + 0.5f, walk->minY + 0.5f) +
+            MAX(in.z.a * (walk->maxX - walk->minX), 0.0f) +
+            MAX(in.z.b * (walk->maxY - walk->minY), 0.0f);
+
+        zmax = MIN(zmax, zcorner);
+
+        if(HiZReject(state->depth_func, zmax, farthest)) {
+            return;
+        }
+    }
+
+#define RASTERIZE(func) \
+    (state->depth_write) ? \
+        RasterizeBlocks(target, walk, &in, state, &level, func, true) : \
+        RasterizeBlocks(target, walk, &in, state, &level, func, false)
+
+    switch(state->depth_func) {
+        case GPU_DEPTHCMP_LESS: RASTERIZE(GPU_DEPTHCMP_LESS); break;
+        case GPU_DEPTHCMP_EQUAL: RASTERIZE(GPU_DEPTHCMP_EQUAL); break;
+        case GPU_DEPTHCMP_LEQUAL: RASTERIZE(GPU_DEPTHCMP_LEQUAL); break;
+        case GPU_DEPTHCMP_GREATER: RASTERIZE(GPU_DEPTHCMP_GREATER); break;
+        case GPU_DEPTHCMP_NOTEQUAL: RASTERIZE(GPU_DEPTHCMP_NOTEQUAL); break;
+        case GPU_DEPTHCMP_GEQUAL: RASTERIZE(GPU_DEPTHCMP_GEQUAL); break;
+        case GPU_DEPTHCMP_ALWAYS:
+        default:
+            RASTERIZE(GPU_DEPTHCMP_ALWAYS);
+    }
+
+#undef RASTERIZE
+}
+
+void RasterizeTriangle(const RenderTarget* target, const Triangle* tri, const Vertex* vertices, const PolyState* state, const Rect* clip) {
+    BlockWalk walk;
+
+    if(state->depth_func == GPU_DEPTHCMP_NEVER || !BlockWalkBounds(&walk, tri, clip)) {
+        return;
+    }
+
+    walk.ids = NULL;
+    walk.fragments = NULL;
+    RasterizeWalk(target, &walk, tri, vertices, state);
+}
+
+void RasterizeTriangleDepth(const RenderTarget* target, const Triangle* tri, const Vertex* vertices, const PolyState* state, const Rect* clip, uint32_t id, uint32_t* ids, int stride) {
+    BlockWalk walk;
+
+    if(state->depth_func == GPU_DEPTHCMP_NEVER || !BlockWalkBounds(&walk, tri, clip)) {
+        return;
+    }
+
+    walk.fragments = NULL;
+    walk.ids = ids;
+    walk.id = id;
+    walk.ids_stride = stride;
+    walk.ids_left = clip->left;
+    walk.ids_top = clip->top;
+    RasterizeWalk(target, &walk, tri, vertices, state);
+}
+
+/* Mask of the pixels of a block whose id matches, ids is the first pixel
+ * of the block */
+GL_FORCE_INLINE uint32_t IdMatchBlock(const uint32_t* ids, int stride, uint32_t id) {
+    uint32_t mask = 0;
+
+#ifdef __SSE2__
+    const __m128i match = _mm_set1_epi32(id);
+
+    for(int y = 0; y < BLOCK_SIZE; ++y, ids += stride) {
+        const __m128i row = _mm_loadu_si128((const __m128i*) ids);
+        mask |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(row, match))) << (y * BLOCK_SIZE);
+    }
+#else
+    for(int y = 0; y < BLOCK_SIZE; ++y, ids += stride) {
+        for(int x = 0; x < BLOCK_SIZE; ++x) {
+            if(ids[x] == id) {
+                mask |= 1 << (y * BLOCK_SIZE + x);
+            }
+        }
+    }
+#endif
+
+    return mask;
+}
+
+void ShadeTriangle(const RenderTarget* target, const Triangle* tri, const Vertex* vertices, const PolyState* state, const Rect* clip, uint32_t id, const uint32_t* ids, int stride) {
+    BlockWalk walk;
+
+    if(!BlockWalkBounds(&walk, tri, clip)) {
+        return;
+    }
+
+    const int bx0 = walk.minX & ~(BLOCK_SIZE - 1);
+    const int by0 = walk.minY & ~(BLOCK_SIZE - 1);
+
+    /* Set up when the first visible pixel turns up, so that triangles
+     * which are hidden in this tile cost nothing more */
+    Interpolants in;
+    TextureLevel level;
+    bool ready = false;
+
+    for(int by = by0; by <= walk.maxY; by += BLOCK_SIZE) {
+        const uint32_t* row = ids + (by - clip->top) * stride - clip->left;
+
+        for(int bx = bx0; bx <= walk.maxX; bx += BLOCK_SIZE) {
+            const uint32_t mask = IdMatchBlock(row + bx, stride, id);
+
+            if(!mask) {
+                continue;
+            }
+
+            if(!ready) {
+                InterpolantsInit(&in, &level, tri, vertices, state);
+                ready = true;
+            }
+
+            uint32_t colour[BLOCK_SIZE * BLOCK_SIZE];
+            ShadeBlock(&in, state, &level, bx, by, mask, colour);
+            BlendBlock(target, state, bx, by, mask, colour);
+        }
+    }
+}
+
+void FragmentBufferInit(FragmentBuffer* buffer, uint32_t capacity, uint16_t width, uint16_t height) {
+    buffer->fragments = (Fragment*) malloc(sizeof(Fragment) * capacity);
+    buffer->capacity = capacity;
+    buffer->count = 0;
+    buffer->heads = (uint32_t*) malloc(sizeof(uint32_t) * width * height);
+    buffer->counts = (uint8_t*) malloc(width * height);
+    buffer->width = width;
+    buffer->height = height;
+    buffer->overflow = false;
+}
+
+void FragmentBufferReset(FragmentBuffer* buffer, const Rect* rect) {
+    buffer->count = 0;
+    buffer->rect = *rect;
+    buffer->overflow = false;
+
+    memset(buffer->heads, 0xFF, sizeof(uint32_t) * buffer->width * buffer->height);
+    memset(buffer->counts, 0, buffer->width * buffer->height);
+}
+
+void RasterizeTriangleFragments(const RenderTarget* target, const Triangle* tri, const Vertex* vertices, const PolyState* state, FragmentBuffer* buffer) {
+    BlockWalk walk;
+
+    if(buffer->overflow || state->depth_func == GPU_DEPTHCMP_NEVER || !BlockWalkBounds(&walk, tri, &buffer->rect)) {
+        return;
+    }
+
+    /* Nothing is written until the fragments are resolved, so depth
+     * writes are left until then too */
+    PolyState collect = *state;
+    collect.depth_write = false;
+
+    walk.ids = NULL;
+    walk.fragments = buffer;
+    walk.state = tri->state;
+    RasterizeWalk(target, &walk, tri, vertices, &collect);
+}
+
+void FragmentBufferResolve(FragmentBuffer* buffer, const RenderTarget* target, const PolyState* states) {
+    const Rect* rect = &buffer->rect;
+
+    for(int y = rect->top; y <= rect->bottom; ++y) {
+        const int row = (y - rect->top) * buffer->width - rect->left;
+
+        for(int x = rect->left; x <= rect->right; ++x) {
+            const int count = buffer->counts[row + x];
+
+            if(!count) {
+                continue;
+            }
+
+            /* Lists run newest first, so filling the array from the end
+             * leaves it in submission order. Insertion sort keeps that
+             * order between fragments at the same depth. */
+            const Fragment* sorted[FRAGMENTS_PER_PIXEL_MAX];
+            uint32_t next = buffer->heads[row + x];
+
+            for(int i = count - 1; i >= 0; --i) {
+                const Fragment* fragment = &buffer->fragments[next];
+                next = fragment->next;
+
+                int j = i + 1;
+                while(j < count && sorted[j]->z < fragment->z) {
+                    sorted[j - 1] = sorted[j];
+                    ++j;
+                }
+
+                sorted[j - 1] = fragment;
+            }
+
+            const int pixel = y * target->width + x;
+            uint32_t colour = target->colour[pixel];
+
+            for(int i = 0; i < count; ++i) {
+                const PolyState* state = &states[sorted[i]->state];
+                colour = BlendPixel(state, sorted[i]->colour, colour);
+
+                if(state->depth_write) {
+                    target->depth[pixel] = sorted[i]->z;
+                    target->hiz_dirty[(y >> HIZ_BLOCK_SHIFT) * target->hiz_width + (x >> HIZ_BLOCK_SHIFT)] = 1;
+                }
+            }
+
+            target->colour[pixel] = colour;
+        }
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../types.h"
+#include "../../platform.h"
+#include "sampler.h"
+#include "edge_equation.h"
+#include "fog_table.h"
+
+/* Hierarchical Z is kept per 8x8 pixel block */
+#define HIZ_BLOCK_SIZE 8
+#define HIZ_BLOCK_SHIFT 3
+
+/* The colour (ARGB8888) and depth (1/w) buffers the rasterizer draws into.
+ *
+ * hiz holds the farthest (smallest) 1/w in each 8x8 block of the depth
+ * buffer. It's refreshed lazily: writing depth only flags the block in
+ * hiz_dirty, and it's recomputed the next time a triangle needs it. */
+typedef struct RenderTarget {
+    uint32_t* colour;
+    float* depth;
+    float* hiz;
+    uint8_t* hiz_dirty;
+    uint16_t width;
+    uint16_t height;
+    uint16_t hiz_width;
+    uint16_t hiz_height;
+} RenderTarget;
+
+void RenderTargetInit(RenderTarget* target, uint16_t width, uint16_t height);
+
+/* Changes the size of the target, reusing its buffers, so it can't grow
+ * past the size it was created with */
+void RenderTargetResize(RenderTarget* target, uint16_t width, uint16_t height);
+void RenderTargetClear(RenderTarget* target, uint32_t colour, float depth);
+
+/* Inclusive pixel rectangle */
+typedef struct Rect {
+    int16_t left;
+    int16_t top;
+    int16_t right;
+    int16_t bottom;
+} Rect;
+
+/* How fragments are combined with the colour buffer. The common factor
+ * pairs get their own loops, anything else goes through BLEND_GENERIC */
+typedef enum BlendMode {
+    BLEND_REPLACE,      /* ONE, ZERO */
+    BLEND_ALPHA,        /* SRCALPHA, INVSRCALPHA */
+    BLEND_ADD,          /* ONE, ONE */
+    BLEND_MODULATE,     /* ZERO, DESTCOLOR (the source colour, for dst) */
+    BLEND_GENERIC
+} BlendMode;
+
+/* The parts of a polygon header which affect rasterization, decoded once
+ * per header rather than per triangle */
+typedef struct PolyState {
+    GPUCulling culling;
+    GPUDepthCompare depth_func;
+    bool depth_write;
+    bool textured;
+    bool alpha;             /* False if vertex alpha is treated as opaque */
+    bool punch_through;     /* Drop fragments below alpha_cutoff */
+    uint8_t alpha_cutoff;
+    GPUBlend src_blend;
+    GPUBlend dst_blend;
+    BlendMode blend;
+    GPUUserClip clip_mode;
+    Rect clip;              /* The user clip rectangle clip_mode refers to */
+    const FogTable* fog;    /* NULL unless the header uses table fog */
+    Texture texture;
+} PolyState;
+
+/* texture_memory is where the texture offsets in the header point into,
+ * and fog is the table for headers which use table fog. The user clip
+ * rectangle isn't part of the header, it's left for the caller to fill
+ * in. */
+void PolyStateInit(PolyState* state, const PolyHeader* header, const uint8_t* texture_memory, const FogTable* fog);
+
+/* Snaps the screen position of a vertex to subpixels */
+void VertexSnap(const Vertex* v, int32_t* out);
+
+/* A triangle which has been culled and set up for rasterization. Vertices
+ * are reordered so that the triangle always has a positive area, and the
+ * bounds are already clamped to the render target (and to the user clip
+ * rectangle, when drawing inside it). */
+typedef struct Triangle {
+    uint32_t v[3];      /* Indices of the vertices in the list */
+    EdgeEquation e[3];  /* v0 to v1, v1 to v2 and v2 to v0 */
+    int64_t area2;      /* The value of e[0] at v2 */
+    Rect bounds;
+    uint32_t state;     /* Index of the PolyState this triangle was submitted with */
+} Triangle;
+
+/* Sets up the triangle made of the vertices at the given indices, from
+ * their snapped positions p and the edges between them in the same order.
+ * Strips share edges between neighbouring triangles, so the caller keeps
+ * them rather than having them recomputed here.
+ *
+ * Returns false if the triangle was culled, or doesn't cover any pixels */
+bool TriangleSetup(Triangle* tri, const uint32_t* index, const int32_t (*p)[2], const EdgeEquation* e, const PolyState* state, const RenderTarget* target);
+
+/* Draws the part of the triangle which falls within the clip rectangle.
+ * vertices are the ones the triangle indices refer to. */
+void RasterizeTriangle(const RenderTarget* target, const Triangle* tri, const Vertex* vertices, const PolyState* state, const Rect* clip);
+
+/* Deferred shading, as the PVR does for opaque polygons: every triangle
+ * of a tile is depth tested first, leaving the id of the last one to
+ * pass at each pixel in ids, then only those are shaded. That only gives
+ * the same result when each triangle replaces the colour, without
+ * blending or alpha testing.
+ *
+ * ids covers the clip rectangle, rounded out to whole 4x4 blocks, and is
+ * zeroed before the first triangle. */
+void RasterizeTriangleDepth(const RenderTarget* target, const Triangle* tri, const Vertex* vertices, const PolyState* state, const Rect* clip, uint32_t id, uint32_t* ids, int stride);
+void ShadeTriangle(const RenderTarget* target, const Triangle* tri, const Vertex* vertices, const PolyState* state, const Rect* clip, uint32_t id, const uint32_t* ids, int stride);
+
+/* A translucent fragment waiting to be blended */
+typedef struct Fragment {
+    float z;
+    uint32_t colour;
+    uint32_t state;     /* Index of the PolyState it was drawn with */
+    uint32_t next;      /* The one before it at the same pixel */
+} Fragment;
+
+#define FRAGMENT_NONE 0xFFFFFFFF
+
+/* The most fragments a single pixel can have sorted */
+#define FRAGMENTS_PER_PIXEL_MAX 32
+
+/* The translucent fragments drawn within a rectangle, listed per pixel so
+ * that they can be blended far to near, the way the PVR autosorts
+ * translucent polygons. Fragments are depth tested as they're added but
+ * nothing is written until they're resolved.
+ *
+ * Memory is fixed. If it runs out, or a pixel gets too many fragments to
+ * sort, overflow is set and the caller should draw the rectangle in
+ * submission order instead. */
+typedef struct FragmentBuffer {
+    Fragment* fragments;
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t* heads;    /* The last fragment at each pixel */
+    uint8_t* counts;
+    uint16_t width;
+    uint16_t height;
+    Rect rect;
+    bool overflow;
+} FragmentBuffer;
+
+/* width and height are the largest rectangle the buffer will be used for */
+void FragmentBufferInit(FragmentBuffer* buffer, uint32_t capacity, uint16_t width, uint16_t height);
+
+/* Empties the buffer, ready to collect fragments within rect */
+void FragmentBufferReset(FragmentBuffer* buffer, const Rect* rect);
+
+void RasterizeTriangleFragments(const RenderTarget* target, const Triangle* tri, const Vertex* vertices, const PolyState* state, FragmentBuffer* buffer);
+
+/* Blends the fragments at each pixel far to near, in submission order
+ * where they're at the same depth. states are the ones the triangles
+ * were drawn with. */
+void FragmentBufferResolve(FragmentBuffer* buffer, const RenderTarget* target, const PolyState* states);
@@ -0,0 +1,379 @@
+#include <math.h>
+
+#include "../../private.h"
+#include "sampler.h"
+
+/* The VQ codebook sits in front of the index data */
+#define VQ_CODEBOOK_SIZE 2048
+
+/* Entries as written by GPUSetPaletteEntry, and the same converted to
+ * ARGB8888 for the current palette format */
+static uint32_t PALETTE_RAW[PALETTE_ENTRIES];
+static uint32_t PALETTE[PALETTE_ENTRIES];
+static GPUPaletteFormat PALETTE_FORMAT = GPU_PAL_ARGB8888;
+
+static uint32_t PALETTE_GENERATION = 0;
+static uint32_t BANK_GENERATION[PALETTE_ENTRIES / PALETTE_BANK_SIZE];
+
+GL_FORCE_INLINE uint32_t Expand5(uint32_t c) {
+    return (c << 3) | (c >> 2);
+}
+
+GL_FORCE_INLINE uint32_t Expand6(uint32_t c) {
+    return (c << 2) | (c >> 4);
+}
+
+GL_FORCE_INLINE uint32_t ARGB1555ToARGB8888(uint32_t p) {
+    return ((p & 0x8000) ? 0xFF000000 : 0) |
+        (Expand5((p >> 10) & 0x1F) << 16) |
+        (Expand5((p >> 5) & 0x1F) << 8) |
+        Expand5(p & 0x1F);
+}
+
+GL_FORCE_INLINE uint32_t RGB565ToARGB8888(uint32_t p) {
+    return 0xFF000000 |
+        (Expand5((p >> 11) & 0x1F) << 16) |
+        (Expand6((p >> 5) & 0x3F) << 8) |
+        Expand5(p & 0x1F);
+}
+
+GL_FORCE_INLINE uint32_t ARGB4444ToARGB8888(uint32_t p) {
+    return (((p >> 12) & 0xF) * 0x11000000) |
+        (((p >> 8) & 0xF) * 0x110000) |
+        (((p >> 4) & 0xF) * 0x1100) |
+        ((p & 0xF) * 0x11);
+}
+
+static uint32_t PaletteConvert(uint32_t value) {
+    switch(PALETTE_FORMAT) {
+        case GPU_PAL_ARGB1555: return ARGB1555ToARGB8888(value);
+        case GPU_PAL_RGB565: return RGB565ToARGB8888(value);
+        case GPU_PAL_ARGB4444: return ARGB4444ToARGB8888(value);
+        case GPU_PAL_ARGB8888:
+        default:
+            return value;
+    }
+}
+
+void PaletteSetFormat(GPUPaletteFormat format) {
+    PALETTE_FORMAT = format;
+
+    /* The PVR interprets palette RAM at sampling time, so entries
+     * written before a format change are read in the new format */
+    for(uint32_t i = 0; i < PALETTE_ENTRIES; ++i) {
+        PALETTE[i] = PaletteConvert(PALETTE_RAW[i]);
+    }
+
+    ++PALETTE_GENERATION;
+    for(uint32_t i = 0; i < PALETTE_ENTRIES / PALETTE_BANK_SIZE; ++i) {
+        BANK_GENERATION[i] = PALETTE_GENERATION;
+    }
+}
+
+void PaletteSetEntry(uint32_t idx, uint32_t value) {
+    if(idx >= PALETTE_ENTRIES) {
+        return;
+    }
+
+    PALETTE_RAW[idx] = value;
+    PALETTE[idx] = PaletteConvert(value);
+    BANK_GENERATION[idx / PALETTE_BANK_SIZE] = ++PALETTE_GENERATION;
+}
+
+void TextureInit(Texture* tex, const PolyHeader* header, const uint8_t* memory) {
+    const uint32_t mode2 = header->mode2;
+    const uint32_t mode3 = header->mode3;
+
+    tex->format = (TexelFormat) ((mode3 >> 27) & 7);
+    tex->vq = (mode3 & GPU_TXRFMT_VQ_ENABLE) != 0;
+    tex->width = 8 << ((mode2 & GPU_TA_PM2_USIZE_MASK) >> GPU_TA_PM2_USIZE_SHIFT);
+    tex->height = 8 << ((mode2 & GPU_TA_PM2_VSIZE_MASK) >> GPU_TA_PM2_VSIZE_SHIFT);
+    tex->base = memory + ((mode3 & 0x1FFFFF) << 3);
+    tex->codebook = NULL;
+    tex->palette = NULL;
+    tex->decoded = NULL;
+
+    if(tex->format == TEXEL_PAL4BPP) {
+        /* Paletted textures are always twiddled, and use the scan order
+         * and stride bits to select the bank instead */
+        tex->twiddled = true;
+        tex->palette = PALETTE + ((mode3 >> 21) & 0x3F) * 16;
+    } else if(tex->format == TEXEL_PAL8BPP) {
+        tex->twiddled = true;
+        tex->palette = PALETTE + ((mode3 >> 25) & 0x3) * 256;
+    } else {
+        /* VQ textures must be twiddled on the PVR */
+        tex->twiddled = tex->vq || !(mode3 & GPU_TXRFMT_NONTWIDDLED);
+    }
+
+    if(tex->vq) {
+        tex->codebook = tex->base;
+        tex->base += VQ_CODEBOOK_SIZE;
+    }
+
+    /* Mipmaps are only possible on square textures */
+    tex->levels = 1;
+    if((mode3 & GPU_TA_PM3_MIPMAP_MASK) && tex->width == tex->height) {
+        while((1u << (tex->levels - 1)) < tex->width) {
+            tex->levels++;
+        }
+    }
+
+    /* Trilinear is approximated by bilinear on the nearest level */
+    const uint32_t filter = (mode2 & GPU_TA_PM2_FILTER_MASK) >> GPU_TA_PM2_FILTER_SHIFT;
+    tex->bilinear = filter != GPU_FILTER_NEAREST;
+
+    tex->alpha = ((mode2 & GPU_TA_PM2_TXRALPHA_MASK) >> GPU_TA_PM2_TXRALPHA_SHIFT) == GPU_TXRALPHA_ENABLE;
+    tex->clamp = (mode2 & GPU_TA_PM2_UVCLAMP_MASK) >> GPU_TA_PM2_UVCLAMP_SHIFT;
+    tex->flip = (mode2 & GPU_TA_PM2_UVFLIP_MASK) >> GPU_TA_PM2_UVFLIP_SHIFT;
+    tex->env = (GPUTextureEnv) ((mode2 & GPU_TA_PM2_TXRENV_MASK) >> GPU_TA_PM2_TXRENV_SHIFT);
+
+    /* The D adjust is in quarters, with 4 meaning no bias */
+    uint32_t bias = (mode2 & GPU_TA_PM2_MIPBIAS_MASK) >> GPU_TA_PM2_MIPBIAS_SHIFT;
+    tex->lod_bias = log2f((bias ? bias : 4) / 4.0f);
+}
+
+/* Byte offset of the mipmap level of the given size from the start of
+ * the chain, laid out as _glGetMipmapDataOffset does. The smallest level
+ * comes first, after a little padding. */
+static uint32_t MipmapOffset(const Texture* tex, uint32_t size) {
+    if(tex->vq) {
+        /* One index byte per 2x2 block, and the 2x2 level shares
+         * a single index with the 1x1 one */
+        uint32_t offset = 0;
+        for(uint32_t s = 1; s < size; s *= 2) {
+            offset += MAX(1, (s / 2) * (s / 2));
+        }
+        return offset;
+    } else if(tex->format == TEXEL_PAL4BPP || tex->format == TEXEL_PAL8BPP) {
+        uint32_t offset = 3;
+        for(uint32_t s = 1; s < size; s *= 2) {
+            offset += s * s;
+        }
+        return offset;
+    } else {
+        uint32_t offset = 6;
+        for(uint32_t s = 1; s < size; s *= 2) {
+            offset += s * s * 2;
+        }
+        return offset;
+    }
+}
+
+void TextureSelectLevel(const Texture* tex, float texels_per_pixel, TextureLevel* out) {
+    int level = 0;
+    uint32_t skipped = 0;
+
+    if(tex->levels > 1 && texels_per_pixel > 0.0f) {
+        /* The ratio is between areas, so halve the log to get it
+         * along each axis */
+        const float lod = 0.5f * log2f(texels_per_pixel) + tex->lod_bias;
+        level = (int) (lod + 0.5f);
+        level = MAX(level, 0);
+        level = MIN(level, tex->levels - 1);
+    }
+
+    out->width = tex->width >> level;
+    out->height = tex->height >> level;
+    out->data = tex->base;
+    out->texels = NULL;
+
+    if(tex->levels > 1) {
+        out->data += MipmapOffset(tex, out->width);
+    }
+
+    if(tex->decoded) {
+        /* Decoded levels are stored largest first */
+        for(int i = 0; i < level; ++i) {
+            skipped += (tex->width >> i) * (tex->height >> i);
+        }
+
+        out->texels = tex->decoded + skipped;
+    }
+}
+
+static uint32_t TexelDecode(const Texture* tex, const TextureLevel* level, uint32_t x, uint32_t y) {
+    if(tex->vq) {
+        /* Each index picks a 2x2 block of the codebook, which is itself
+         * twiddled */
+        const uint32_t bw = MAX(level->width / 2, 1);
+        const uint32_t bh = MAX(level->height / 2, 1);
+        const uint8_t idx = level->data[TwiddledIndex(x / 2, y / 2, bw, bh)];
+        const uint16_t p = ((const uint16_t*) tex->codebook)[idx * 4 + ((y & 1) | ((x & 1) << 1))];
+
+        switch(tex->format) {
+            case TEXEL_ARGB1555: return ARGB1555ToARGB8888(p);
+            case TEXEL_RGB565: return RGB565ToARGB8888(p);
+            case TEXEL_ARGB4444: return ARGB4444ToARGB8888(p);
+            default:
+                return 0xFFFFFFFF;
+        }
+    }
+
+    const uint32_t t = (tex->twiddled) ?
+        TwiddledIndex(x, y, level->width, level->height) :
+        y * level->width + x;
+
+    switch(tex->format) {
+        case TEXEL_ARGB1555: return ARGB1555ToARGB8888(((const uint16_t*) level->data)[t]);
+        case TEXEL_RGB565: return RGB565ToARGB8888(((const uint16_t*) level->data)[t]);
+        case TEXEL_ARGB4444: return ARGB4444ToARGB8888(((const uint16_t*) level->data)[t]);
+        case TEXEL_PAL8BPP: return tex->palette[level->data[t]];
+        case TEXEL_PAL4BPP: return tex->palette[(level->data[t >> 1] >> ((t & 1) * 4)) & 0xF];
+        default:
+            /* YUV422 and bump maps are never uploaded by GLdc */
+            return 0xFFFFFFFF;
+    }
+}
+
+GL_FORCE_INLINE uint32_t TexelFetch(const Texture* tex, const TextureLevel* level, uint32_t x, uint32_t y) {
+    if(level->texels) {
+        return level->texels[y * level->width + x];
+    }
+
+    return TexelDecode(tex, level, x, y);
+}
+
+/* Maps a texel coordinate into [0, size) following the wrap mode */
+GL_FORCE_INLINE uint32_t TexelAddress(int c, int size, bool clamp, bool flip) {
+    if(clamp) {
+        return MIN(MAX(c, 0), size - 1);
+    } else if(flip) {
+        /* Mirrored every other repeat */
+        const int r = c & (size - 1);
+        return (c & size) ? (size - 1 - r) : r;
+    } else {
+        return c & (size - 1);
+    }
+}
+
+GL_FORCE_INLINE uint32_t Lerp8888(uint32_t a, uint32_t b, uint32_t f) {
+    /* f is 0-256, blends two channels at a time */
+    const uint32_t rb = ((((a & 0x00FF00FF) * (256 - f)) + ((b & 0x00FF00FF) * f)) >> 8) & 0x00FF00FF;
+    const uint32_t ag = ((((a >> 8) & 0x00FF00FF) * (256 - f)) + (((b >> 8) & 0x00FF00FF) * f)) & 0xFF00FF00;
+    return rb | ag;
+}
+
+uint32_t TextureSample(const Texture* tex, const TextureLevel* level, float u, float v) {
+    const int w = level->width;
+    const int h = level->height;
+
+    const bool clamp_u = (tex->clamp & GPU_UVCLAMP_U) != 0;
+    const bool clamp_v = (tex->clamp & GPU_UVCLAMP_V) != 0;
+    const bool flip_u = (tex->flip & GPU_UVFLIP_U) != 0;
+    const bool flip_v = (tex->flip & GPU_UVFLIP_V) != 0;
+
+    if(!tex->bilinear) {
+        const int x = (int) floorf(u * w);
+        const int y = (int) floorf(v * h);
+        return TexelFetch(
+            tex, level,
+            TexelAddress(x, w, clamp_u, flip_u),
+            TexelAddress(y, h, clamp_v, flip_v)
+        );
+    }
+
+    /* Texel centres are at half coordinates */
+    const float fu = u * w - 0.5f;
+    const float fv = v * h - 0.5f;
+    const float x0f = floorf(fu);
+    const float y0f = floorf(fv);
+    const int x0 = (int) x0f;
+    const int y0 = (int) y0f;
+    const uint32_t fx = (uint32_t) ((fu - x0f) * 256.0f);
+    const uint32_t fy = (uint32_t) ((fv - y0f) * 256.0f);
+
+    const uint32_t ax = TexelAddress(x0, w, clamp_u, flip_u);
+    const uint32_t bx = TexelAddress(x0 + 1, w, clamp_u, flip_u);
+    const uint32_t ay = TexelAddress(y0, h, clamp_v, flip_v);
+    const uint32_t by = TexelAddress(y0 + 1, h, clamp_v, flip_v);
+
+    const uint32_t top = Lerp8888(TexelFetch(tex, level, ax, ay), TexelFetch(tex, level, bx, ay), fx);
+    const uint32_t bottom = Lerp8888(TexelFetch(tex, level, ax, by), TexelFetch(tex, level, bx, by), fx);
+    return Lerp8888(top, bottom, fy);
+}
+
+/* Bytes of texture memory used by a single level */
+static uint32_t LevelSize(const Texture* tex, uint32_t w, uint32_t h) {
+    if(tex->vq) {
+        return MAX((w / 2) * (h / 2), 1);
+    }
+
+    switch(tex->format) {
+        case TEXEL_PAL4BPP: return MAX((w * h) / 2, 1);
+        case TEXEL_PAL8BPP: return w * h;
+        default:
+            return w * h * 2;
+    }
+}
+
+const uint8_t* TextureDataStart(const Texture* tex) {
+    return (tex->vq) ? tex->codebook : tex->base;
+}
+
+uint32_t TextureDataSize(const Texture* tex) {
+    uint32_t size = LevelSize(tex, tex->width, tex->height);
+
+    if(tex->levels > 1) {
+        size += MipmapOffset(tex, tex->width);
+    }
+
+    if(tex->vq) {
+        size += VQ_CODEBOOK_SIZE;
+    }
+
+    return size;
+}
+
+uint32_t TexturePaletteGeneration(const Texture* tex) {
+    uint32_t first, count;
+
+    if(tex->format == TEXEL_PAL4BPP) {
+        count = 16 / PALETTE_BANK_SIZE;
+    } else if(tex->format == TEXEL_PAL8BPP) {
+        count = 256 / PALETTE_BANK_SIZE;
+    } else {
+        return 0;
+    }
+
+    first = (tex->palette - PALETTE) / PALETTE_BANK_SIZE;
+
+    uint32_t generation = 0;
+    for(uint32_t i = first; i < first + count; ++i) {
+        generation = MAX(generation, BANK_GENERATION[i]);
+    }
+
+    return generation;
+}
+
+uint32_t TextureDecodedCount(const Texture* tex) {
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < tex->levels; ++i) {
+        count += (tex->width >> i) * (tex->height >> i);
+    }
+
+    return count;
+}
+
+void TextureDecode(const Texture* tex, uint32_t* out) {
+    Texture raw = *tex;
+    raw.decoded = NULL;
+
+    for(uint32_t i = 0; i < tex->levels; ++i) {
+        TextureLevel level;
+        level.width = tex->width >> i;
+        level.height = tex->height >> i;
+        level.data = tex->base;
+        level.texels = NULL;
+
+        if(tex->levels > 1) {
+            level.data += MipmapOffset(tex, level.width);
+        }
+
+        for(uint32_t y = 0; y < level.height; ++y) {
+            for(uint32_t x = 0; x < level.width; ++x) {
+                *out++ = TexelDecode(&raw, &level, x, y);
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../types.h"
+#include "../../platform.h"
+
+/* Texture memory is addressed the same way as PVR VRAM: the header holds
+ * the offset of the texture into it, in 8 byte units. The arena is
+ * aligned to its own size so an offset can be recovered from a pointer
+ * with a mask, just like CompilePolyHeader does. */
+#define TEXTURE_MEMORY_SIZE (16 * 1024 * 1024)
+
+/* Palette RAM, shared by every paletted texture */
+#define PALETTE_ENTRIES 1024
+
+void PaletteSetFormat(GPUPaletteFormat format);
+void PaletteSetEntry(uint32_t idx, uint32_t value);
+
+/* Palette RAM is tracked in banks of 16 entries, each remembering the
+ * generation it was last written in */
+#define PALETTE_BANK_SIZE 16
+
+/* PVR pixel formats, as stored in bits 27-29 of mode3 */
+typedef enum TexelFormat {
+    TEXEL_ARGB1555 = 0,
+    TEXEL_RGB565 = 1,
+    TEXEL_ARGB4444 = 2,
+    TEXEL_YUV422 = 3,
+    TEXEL_BUMP = 4,
+    TEXEL_PAL4BPP = 5,
+    TEXEL_PAL8BPP = 6
+} TexelFormat;
+
+/* The texture parts of a polygon header, decoded once per header */
+typedef struct Texture {
+    const uint8_t* base;        /* Level 0, or the start of the mipmap chain */
+    const uint8_t* codebook;    /* VQ only, 256 2x2 blocks of 16bpp texels */
+    const uint32_t* palette;    /* Paletted only, the selected bank */
+    const uint32_t* decoded;    /* Every level as linear ARGB8888, if cached */
+    TexelFormat format;
+    uint16_t width;
+    uint16_t height;
+    uint8_t levels;             /* 1 unless mipmapped */
+    bool twiddled;
+    bool vq;
+    bool bilinear;
+    bool alpha;                 /* False if texture alpha is ignored */
+    uint8_t clamp;              /* GPUUVClamp */
+    uint8_t flip;               /* GPUUVFlip */
+    GPUTextureEnv env;
+    float lod_bias;             /* log2 of the mipmap D adjust */
+} Texture;
+
+/* One mipmap level of a texture */
+typedef struct TextureLevel {
+    const uint8_t* data;
+    const uint32_t* texels;     /* The decoded level, if there is one */
+    uint16_t width;
+    uint16_t height;
+} TextureLevel;
+
+void TextureInit(Texture* tex, const PolyHeader* header, const uint8_t* memory);
+
+#define TWIDTAB(x) ( (x&1)|((x&2)<<1)|((x&4)<<2)|((x&8)<<3)|((x&16)<<4)| \
+                     ((x&32)<<5)|((x&64)<<6)|((x&128)<<7)|((x&256)<<8)|((x&512)<<9) )
+
+/* Index of texel (x, y) in a twiddled texture. Rectangular textures are
+ * a row or column of square twiddled blocks, as GPUTextureTwiddle16BPP
+ * lays them out. */
+static inline uint32_t TwiddledIndex(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    const uint32_t min = (w < h) ? w : h;
+    const uint32_t mask = min - 1;
+    return (TWIDTAB((y & mask)) | (TWIDTAB((x & mask)) << 1)) + (x / min + y / min) * min * min;
+}
+
+/* The bytes of texture memory the texture reads, including the codebook
+ * and every mipmap level */
+const uint8_t* TextureDataStart(const Texture* tex);
+uint32_t TextureDataSize(const Texture* tex);
+
+/* The latest generation any palette entry the texture uses was written
+ * in, 0 if it isn't paletted */
+uint32_t TexturePaletteGeneration(const Texture* tex);
+
+/* Number of texels in all levels, and decoding them level by level,
+ * largest first, as linear ARGB8888 */
+uint32_t TextureDecodedCount(const Texture* tex);
+void TextureDecode(const Texture* tex, uint32_t* out);
+
+/* Picks the level which best matches a texel to pixel area ratio */
+void TextureSelectLevel(const Texture* tex, float texels_per_pixel, TextureLevel* out);
+
+/* Returns the ARGB8888 colour of the texture at (u, v), filtered as the
+ * header asked for */
+uint32_t TextureSample(const Texture* tex, const TextureLevel* level, float u, float v);
@@ -0,0 +1,148 @@
+#include <stdlib.h>
+
+#include "../../../containers/aligned_vector.h"
+#include "texture_cache.h"
+
+#define DEFAULT_BUDGET (32 * 1024 * 1024)
+
+typedef struct CacheEntry {
+    uint32_t mode3;
+    uint32_t size;              /* The size bits of mode2 */
+    uint32_t palette_generation;
+    uint32_t last_used;         /* The list this was last looked up for */
+    const uint8_t* start;       /* Texture memory the texture reads */
+    const uint8_t* end;
+    uint32_t* texels;
+    size_t bytes;
+} CacheEntry;
+
+static AlignedVector ENTRIES;
+static size_t BUDGET = DEFAULT_BUDGET;
+static size_t USED = 0;
+static uint32_t LIST = 1;
+
+/* Consecutive headers usually share a texture */
+static uint32_t LAST_HIT = 0;
+
+static void EntryRemove(uint32_t i) {
+    CacheEntry* entries = (CacheEntry*) ENTRIES.data;
+
+    USED -= entries[i].bytes;
+    free(entries[i].texels);
+
+    entries[i] = entries[ENTRIES.size - 1];
+    aligned_vector_resize(&ENTRIES, ENTRIES.size - 1);
+}
+
+/* Evicts least recently used entries until there's room for the given
+ * number of bytes, without touching anything the current list uses */
+static bool MakeRoom(size_t bytes) {
+    while(USED + bytes > BUDGET) {
+        CacheEntry* entries = (CacheEntry*) ENTRIES.data;
+        uint32_t oldest = ENTRIES.size;
+
+        for(uint32_t i = 0; i < ENTRIES.size; ++i) {
+            if(entries[i].last_used == LIST) {
+                continue;
+            }
+
+            if(oldest == ENTRIES.size || entries[i].last_used < entries[oldest].last_used) {
+                oldest = i;
+            }
+        }
+
+        if(oldest == ENTRIES.size) {
+            return false;
+        }
+
+        EntryRemove(oldest);
+    }
+
+    return true;
+}
+
+void TextureCacheInit() {
+    aligned_vector_init(&ENTRIES, sizeof(CacheEntry));
+}
+
+void TextureCacheSetBudget(size_t bytes) {
+    BUDGET = bytes;
+
+    /* Nothing is being rendered here, so everything can go */
+    ++LIST;
+    MakeRoom(0);
+}
+
+void TextureCacheBeginList() {
+    ++LIST;
+}
+
+const uint32_t* TextureCacheLookup(const Texture* tex, const PolyHeader* header) {
+    const uint32_t size = header->mode2 & (GPU_TA_PM2_USIZE_MASK | GPU_TA_PM2_VSIZE_MASK);
+    const uint32_t palette_generation = TexturePaletteGeneration(tex);
+
+    CacheEntry* entries = (CacheEntry*) ENTRIES.data;
+
+    uint32_t i = LAST_HIT;
+    if(i >= ENTRIES.size || entries[i].mode3 != header->mode3 || entries[i].size != size) {
+        for(i = 0; i < ENTRIES.size; ++i) {
+            if(entries[i].mode3 == header->mode3 && entries[i].size == size) {
+                break;
+            }
+        }
+    }
+
+    if(i < ENTRIES.size) {
+        if(entries[i].palette_generation == palette_generation) {
+            entries[i].last_used = LIST;
+            LAST_HIT = i;
+            return entries[i].texels;
+        }
+
+        /* The palette changed since this was decoded */
+        EntryRemove(i);
+    }
+
+    const size_t bytes = TextureDecodedCount(tex) * sizeof(uint32_t);
+    if(!MakeRoom(bytes)) {
+        return NULL;
+    }
+
+    uint32_t* texels = (uint32_t*) malloc(bytes);
+    if(!texels) {
+        return NULL;
+    }
+
+    TextureDecode(tex, texels);
+
+    CacheEntry entry;
+    entry.mode3 = header->mode3;
+    entry.size = size;
+    entry.palette_generation = palette_generation;
+    entry.last_used = LIST;
+    entry.start = TextureDataStart(tex);
+    entry.end = entry.start + TextureDataSize(tex);
+    entry.texels = texels;
+    entry.bytes = bytes;
+
+    aligned_vector_push_back(&ENTRIES, &entry, 1);
+    USED += bytes;
+    LAST_HIT = ENTRIES.size - 1;
+
+    return texels;
+}
+
+void TextureCacheInvalidate(const void* ptr, size_t size) {
+    const uint8_t* start = (const uint8_t*) ptr;
+    const uint8_t* end = start + size;
+
+    for(uint32_t i = 0; i < ENTRIES.size;) {
+        const CacheEntry* entry = ((const CacheEntry*) ENTRIES.data) + i;
+        if(entry->start < end && start < entry->end) {
+            /* The last entry takes its place, so look at i again */
+            EntryRemove(i);
+        } else {
+            ++i;
+        }
+    }
+}
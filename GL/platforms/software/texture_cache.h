@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sampler.h"
+
+/* Textures decoded to linear ARGB8888, so that sampling doesn't have to
+ * untwiddle or look up codebooks and palettes per texel.
+ *
+ * Entries are keyed by the texture words of the header (base offset,
+ * format, palette bank and size) and remember the palette generation
+ * they were decoded in. Writes to texture memory drop the entries they
+ * touch. Least recently used entries are evicted to stay within the
+ * budget; textures which don't fit are sampled straight from texture
+ * memory instead. */
+
+void TextureCacheInit();
+
+/* Bytes of decoded texels to keep at most, 0 disables the cache */
+void TextureCacheSetBudget(size_t bytes);
+
+/* Call once per list, before the first lookup. Entries looked up for
+ * the list being rendered are never evicted until the next call. */
+void TextureCacheBeginList();
+
+/* Returns the decoded texels of the texture, or NULL if it can't be
+ * cached */
+const uint32_t* TextureCacheLookup(const Texture* tex, const PolyHeader* header);
+
+/* Drops every entry which reads any of the given bytes */
+void TextureCacheInvalidate(const void* ptr, size_t size);
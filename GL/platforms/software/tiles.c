@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "tiles.h"
+
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+
+void TileBinsInit(TileBins* bins, uint16_t width, uint16_t height) {
+    bins->columns = (width + TILE_SIZE - 1) >> TILE_SHIFT;
+    bins->rows = (height + TILE_SIZE - 1) >> TILE_SHIFT;
+    bins->offsets = (uint32_t*) calloc((bins->columns * bins->rows) + 1, sizeof(uint32_t));
+
+    aligned_vector_init(&bins->indices, sizeof(uint32_t));
+}
+
+void TileBinsResize(TileBins* bins, uint16_t width, uint16_t height) {
+    bins->columns = (width + TILE_SIZE - 1) >> TILE_SHIFT;
+    bins->rows = (height + TILE_SIZE - 1) >> TILE_SHIFT;
+}
+
+/* Fills skip with the tiles a triangle drawn with state mustn't touch,
+ * returns false if there aren't any. Only tiles wholly inside the clip
+ * rectangle are skipped. Below the display resolution the rectangle can
+ * cover tiles partly, and the rasterizer masks out the rest of it. */
+static bool TilesSkipped(const PolyState* state, Rect* skip) {
+    if(state->clip_mode != GPU_USERCLIP_OUTSIDE) {
+        return false;
+    }
+
+    skip->left = (state->clip.left + TILE_SIZE - 1) >> TILE_SHIFT;
+    skip->right = ((state->clip.right + 1) >> TILE_SHIFT) - 1;
+    skip->top = (state->clip.top + TILE_SIZE - 1) >> TILE_SHIFT;
+    skip->bottom = ((state->clip.bottom + 1) >> TILE_SHIFT) - 1;
+
+    return skip->left <= skip->right && skip->top <= skip->bottom;
+}
+
+static inline bool TileInRect(int tx, int ty, const Rect* rect) {
+    return tx >= rect->left && tx <= rect->right && ty >= rect->top && ty <= rect->bottom;
+}
+
+void TileBinsBuild(TileBins* bins, const Triangle* triangles, uint32_t count, const PolyState* states) {
+    const uint32_t tile_count = bins->columns * bins->rows;
+    uint32_t* offsets = bins->offsets;
+
+    /* Two passes: first count the triangles touching each tile, then
+     * turn the counts into offsets and scatter the indices. This keeps
+     * every bin contiguous without any per-tile allocations. */
+    memset(offsets, 0, sizeof(uint32_t) * (tile_count + 1));
+
+    uint32_t total = 0;
+    const Triangle* tri = triangles;
+    for(uint32_t i = 0; i < count; ++i, ++tri) {
+        const int tx0 = tri->bounds.left >> TILE_SHIFT;
+        const int tx1 = tri->bounds.right >> TILE_SHIFT;
+        const int ty0 = tri->bounds.top >> TILE_SHIFT;
+        const int ty1 = tri->bounds.bottom >> TILE_SHIFT;
+
+        Rect skip;
+        if(TilesSkipped(&states[tri->state], &skip)) {
+            for(int ty = ty0; ty <= ty1; ++ty) {
+                uint32_t* it = offsets + (ty * bins->columns) + tx0 + 1;
+                for(int tx = tx0; tx <= tx1; ++tx, ++it) {
+                    if(!TileInRect(tx, ty, &skip)) {
+                        (*it)++;
+                        total++;
+                    }
+                }
+            }
+
+            continue;
+        }
+
+        for(int ty = ty0; ty <= ty1; ++ty) {
+            uint32_t* it = offsets + (ty * bins->columns) + tx0 + 1;
+            for(int tx = tx0; tx <= tx1; ++tx) {
+                (*it++)++;
+            }
+        }
+
+        total += (tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+    }
+
+    for(uint32_t i = 0; i < tile_count; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    aligned_vector_reserve(&bins->indices, total);
+    aligned_vector_resize(&bins->indices, total);
+
+    if(!total) {
+        return;
+    }
+
+    uint32_t* indices = (uint32_t*) bins->indices.data;
+
+    /* offsets[N] is used as the write cursor for tile N, once we're done
+     * it has moved along to the end of the tile */
+    tri = triangles;
+    for(uint32_t i = 0; i < count; ++i, ++tri) {
+        const int tx0 = tri->bounds.left >> TILE_SHIFT;
+        const int tx1 = tri->bounds.right >> TILE_SHIFT;
+        const int ty0 = tri->bounds.top >> TILE_SHIFT;
+        const int ty1 = tri->bounds.bottom >> TILE_SHIFT;
+
+        Rect skip;
+        const bool skipping = TilesSkipped(&states[tri->state], &skip);
+
+        for(int ty = ty0; ty <= ty1; ++ty) {
+            uint32_t* it = offsets + (ty * bins->columns) + tx0;
+            for(int tx = tx0; tx <= tx1; ++tx, ++it) {
+                if(skipping && TileInRect(tx, ty, &skip)) {
+                    continue;
+                }
+
+                indices[(*it)++] = i;
+            }
+        }
+    }
+
+    /* Shift along so that offsets[N] is the start of tile N again */
+    memmove(offsets + 1, offsets, sizeof(uint32_t) * tile_count);
+    offsets[0] = 0;
+}
+
+void TileRect(const TileBins* bins, uint32_t tile, const RenderTarget* target, Rect* out) {
+    const uint32_t tx = tile % bins->columns;
+    const uint32_t ty = tile / bins->columns;
+
+    out->left = tx << TILE_SHIFT;
+    out->top = ty << TILE_SHIFT;
+    out->right = MIN(out->left + TILE_SIZE, target->width) - 1;
+    out->bottom = MIN(out->top + TILE_SIZE, target->height) - 1;
+}
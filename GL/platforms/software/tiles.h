@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../../../containers/aligned_vector.h"
+#include "rasterizer.h"
+
+/* Same tile size as the PVR (and what _glApplyScissor assumes) */
+#define TILE_SIZE 32
+#define TILE_SHIFT 5
+
+/* Triangles sorted into screen tiles. The triangle indices for tile
+ * N are indices[offsets[N]] to indices[offsets[N + 1]], in submission
+ * order. */
+typedef struct TileBins {
+    uint16_t columns;
+    uint16_t rows;
+    uint32_t* offsets;
+    AlignedVector indices;
+} TileBins;
+
+void TileBinsInit(TileBins* bins, uint16_t width, uint16_t height);
+
+/* Covers a different size of target, no bigger than the one the bins were
+ * created for */
+void TileBinsResize(TileBins* bins, uint16_t width, uint16_t height);
+/* states are the ones the triangles were submitted with. Triangles drawn
+ * outside the user clip rectangle aren't binned into the tiles wholly
+ * within it. */
+void TileBinsBuild(TileBins* bins, const Triangle* triangles, uint32_t count, const PolyState* states);
+
+/* Returns the pixel rectangle covered by a tile, clamped to the target */
+void TileRect(const TileBins* bins, uint32_t tile, const RenderTarget* target, Rect* out);
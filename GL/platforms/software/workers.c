@@ -0,0 +1,226 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "workers.h"
+
+#define MAX_WORKERS 64
+
+/* Chase-Lev style deque. Tasks are all pushed before a run starts, so
+ * it never needs to grow and the owner never pushes concurrently with
+ * thieves. */
+typedef struct {
+    int32_t top;
+    int32_t bottom;
+    uint32_t capacity;
+    uint32_t* tasks;
+} __attribute__((aligned(64))) TaskDeque;
+
+static TaskDeque DEQUES[MAX_WORKERS];
+static pthread_t THREADS[MAX_WORKERS];
+static uint32_t WORKER_COUNT = 1;
+
+static pthread_mutex_t LOCK = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t WAKE = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t DONE = PTHREAD_COND_INITIALIZER;
+
+/* Bumped for each run (and on shutdown) to wake the workers */
+static uint32_t GENERATION = 0;
+static uint32_t RUNNING = 0;
+static bool QUIT = false;
+
+static WorkerTask TASK_FUNC = NULL;
+static void* TASK_DATA = NULL;
+
+static bool DequePop(TaskDeque* deque, uint32_t* task) {
+    int32_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int32_t t = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if(t > b) {
+        /* Empty */
+        __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    *task = deque->tasks[b];
+
+    if(t == b) {
+        /* Last task, race any thieves for it */
+        bool won = __atomic_compare_exchange_n(
+            &deque->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED
+        );
+        __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+        return won;
+    }
+
+    return true;
+}
+
+static bool DequeSteal(TaskDeque* deque, uint32_t* task) {
+    int32_t t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int32_t b = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+    while(t < b) {
+        *task = deque->tasks[t];
+        if(__atomic_compare_exchange_n(&deque->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            return true;
+        }
+
+        /* Somebody else got there first, t now holds the new top */
+        b = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    }
+
+    return false;
+}
+
+static void RunTasks(uint32_t worker) {
+    uint32_t task;
+
+    while(DequePop(&DEQUES[worker], &task)) {
+        TASK_FUNC(task, worker, TASK_DATA);
+    }
+
+    /* Our own deque is empty, go and help everyone else */
+    for(uint32_t i = 1; i < WORKER_COUNT; ++i) {
+        TaskDeque* victim = &DEQUES[(worker + i) % WORKER_COUNT];
+        while(DequeSteal(victim, &task)) {
+            TASK_FUNC(task, worker, TASK_DATA);
+        }
+    }
+}
+
+static void* WorkerMain(void* arg) {
+    const uint32_t worker = (uint32_t) (uintptr_t) arg;
+    uint32_t generation = 0;
+
+    for(;;) {
+        pthread_mutex_lock(&LOCK);
+        while(GENERATION == generation && !QUIT) {
+            pthread_cond_wait(&WAKE, &LOCK);
+        }
+
+        generation = GENERATION;
+        if(QUIT) {
+            pthread_mutex_unlock(&LOCK);
+            break;
+        }
+        pthread_mutex_unlock(&LOCK);
+
+        RunTasks(worker);
+
+        pthread_mutex_lock(&LOCK);
+        if(--RUNNING == 0) {
+            pthread_cond_signal(&DONE);
+        }
+        pthread_mutex_unlock(&LOCK);
+    }
+
+    return NULL;
+}
+
+void WorkersInit(uint32_t count) {
+    WorkersShutdown();
+
+    if(!count) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        count = (cpus > 0) ? (uint32_t) cpus : 1;
+    }
+
+    if(count > MAX_WORKERS) {
+        count = MAX_WORKERS;
+    }
+
+    QUIT = false;
+    GENERATION = 0;
+    WORKER_COUNT = count;
+
+    for(uint32_t i = 1; i < WORKER_COUNT; ++i) {
+        if(pthread_create(&THREADS[i], NULL, WorkerMain, (void*) (uintptr_t) i) != 0) {
+            /* Run with whatever we managed to start */
+            WORKER_COUNT = i;
+            break;
+        }
+    }
+}
+
+void WorkersShutdown() {
+    if(WORKER_COUNT > 1) {
+        pthread_mutex_lock(&LOCK);
+        QUIT = true;
+        pthread_cond_broadcast(&WAKE);
+        pthread_mutex_unlock(&LOCK);
+
+        for(uint32_t i = 1; i < WORKER_COUNT; ++i) {
+            pthread_join(THREADS[i], NULL);
+        }
+    }
+
+    for(uint32_t i = 0; i < MAX_WORKERS; ++i) {
+        free(DEQUES[i].tasks);
+        DEQUES[i].tasks = NULL;
+        DEQUES[i].capacity = 0;
+    }
+
+    WORKER_COUNT = 1;
+}
+
+uint32_t WorkersCount() {
+    return WORKER_COUNT;
+}
+
+void WorkersRun(WorkerTask func, void* userdata, uint32_t task_count) {
+    if(!task_count) {
+        return;
+    }
+
+    if(WORKER_COUNT == 1) {
+        for(uint32_t i = 0; i < task_count; ++i) {
+            func(i, 0, userdata);
+        }
+        return;
+    }
+
+    TASK_FUNC = func;
+    TASK_DATA = userdata;
+
+    /* Hand each worker a contiguous run of tasks, that keeps neighbouring
+     * tiles together until stealing kicks in. Tasks are pushed in reverse
+     * so that the owner pops them in ascending order. */
+    for(uint32_t w = 0; w < WORKER_COUNT; ++w) {
+        TaskDeque* deque = &DEQUES[w];
+        const uint32_t first = (task_count * w) / WORKER_COUNT;
+        const uint32_t last = (task_count * (w + 1)) / WORKER_COUNT;
+        const uint32_t n = last - first;
+
+        if(deque->capacity < n) {
+            free(deque->tasks);
+            deque->tasks = (uint32_t*) malloc(sizeof(uint32_t) * n);
+            deque->capacity = n;
+        }
+
+        for(uint32_t i = 0; i < n; ++i) {
+            deque->tasks[i] = last - 1 - i;
+        }
+
+        deque->top = 0;
+        deque->bottom = n;
+    }
+
+    pthread_mutex_lock(&LOCK);
+    RUNNING = WORKER_COUNT - 1;
+    ++GENERATION;
+    pthread_cond_broadcast(&WAKE);
+    pthread_mutex_unlock(&LOCK);
+
+    RunTasks(0);
+
+    pthread_mutex_lock(&LOCK);
+    while(RUNNING) {
+        pthread_cond_wait(&DONE, &LOCK);
+    }
+    pthread_mutex_unlock(&LOCK);
+}
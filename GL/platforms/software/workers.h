@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+/* A small pool of threads for rendering tiles in parallel. Each thread has
+ * its own deque of task indices. It pops work from the bottom of its own
+ * deque, and when that runs dry it steals from the top of the others.
+ *
+ * The calling thread takes part as worker 0, so a pool of one thread
+ * starts no threads at all. */
+
+typedef void (*WorkerTask)(uint32_t task, uint32_t worker, void* userdata);
+
+/* 0 means one thread per online CPU */
+void WorkersInit(uint32_t count);
+void WorkersShutdown();
+
+uint32_t WorkersCount();
+
+/* Run task_count tasks, blocking until they have all completed */
+void WorkersRun(WorkerTask func, void* userdata, uint32_t task_count);
@@ -18,6 +18,7 @@
 #define MAX_GLDC_4BPP_PALETTE_SLOTS 16
 #define MAX_GLDC_PALETTE_SLOTS 4
 #define MAX_GLDC_SHARED_PALETTES (MAX_GLDC_PALETTE_SLOTS*MAX_GLDC_4BPP_PALETTE_SLOTS)
+#define MAX_GLDC_LIST_NESTING 64
 
 
 extern void* memcpy4 (void *dest, const void *src, size_t count);
@@ -261,6 +262,20 @@ typedef struct __attribute__((aligned(32))) {
     AlignedVector* extras;
 } SubmissionTarget;
 
+/* Vertices which have already been read from the user's arrays, and can be
+ * copied straight into a submission */
+typedef struct {
+    const Vertex* vertices;
+    const VertexExtra* extras;
+    GLuint count;
+} ConvertedVertices;
+
+void _glConvertVertices(const GLuint first, const GLuint count, Vertex* vertices, VertexExtra* extras);
+void _glDrawConvertedVertices(GLenum mode, GLuint count, const GLuint* indices, const ConvertedVertices* source);
+
+GLint _glGetLockedFirst();
+GLsizei _glGetLockedCount();
+
 Vertex* _glSubmissionTargetStart(SubmissionTarget* target);
 Vertex* _glSubmissionTargetEnd(SubmissionTarget* target);
 
@@ -306,27 +321,82 @@ Matrix4x4* _glGetModelViewMatrix();
 
 void _glWipeTextureOnFramebuffers(GLuint texture);
 
+/* Renders what's been submitted since a framebuffer object was bound into
+ * the texture attached to it, leaving the lists empty */
+void _glRenderToTexture(TextureObject* texture);
+
+/* Swaps the lists with the ones put aside for the default framebuffer */
+void _glSwapFramebufferLists();
+
 GLubyte _glInitTextures();
 
 void _glUpdatePVRTextureContext(PolyContext* context, GLshort textureUnit);
 void _glAllocateSpaceForMipmaps(TextureObject* active);
 
+struct BufferObject;
+
 typedef struct {
     const void* ptr;  // 4
     GLenum type;  // 4
     GLsizei stride;  // 4
     GLint size; // 4
+    struct BufferObject* buffer; // 4, the buffer ptr points into (if any)
 } AttribPointer;
 
 typedef struct {
-    AttribPointer vertex; // 16
-    AttribPointer colour; // 32
-    AttribPointer uv; // 48
-    AttribPointer st; // 64
-    AttribPointer normal; // 80
-    AttribPointer padding; // 96
+    AttribPointer vertex; // 20
+    AttribPointer colour; // 40
+    AttribPointer uv; // 60
+    AttribPointer st; // 80
+    AttribPointer normal; // 100
+    AttribPointer padding; // 120
 } AttribPointerList;
 
+typedef struct BufferObject {
+    GLuint index;
+    GLenum usage;
+    GLsizeiptrARB size;
+    GLubyte* data;
+
+    /* GL_STATIC_DRAW_ARB buffers keep their vertices converted for the
+     * attribute layout they were last drawn with */
+    GLboolean converted_valid;
+    GLboolean converted_normalized;
+    GLuint converted_attributes;
+    AttribPointerList converted_layout;
+    AlignedVector converted_vertices; /* Vertex */
+    AlignedVector converted_extras; /* VertexExtra */
+
+    /* Triangle strips for the ranges of the buffer drawn as GL_TRIANGLES
+     * while GL_STRIPIFY_TRIANGLES_KOS was enabled */
+    AlignedVector strips; /* StripList */
+    AlignedVector strip_indices; /* GLuint */
+    AlignedVector strip_ends; /* GLuint */
+} BufferObject;
+
+typedef struct {
+    GLuint offset;
+    GLuint count;
+    GLenum type;
+    GLuint first_index;
+    GLuint index_count;
+    GLuint first_end;
+    GLuint end_count;
+} StripList;
+
+/* Strips are drawn as a GL_TRIANGLE_STRIP, with the end of a strip at each
+ * of the ends */
+typedef struct {
+    const GLuint* indices;
+    GLuint count;
+    const GLuint* ends;
+    GLuint end_count;
+} TriangleStrips;
+
+void _glInitBuffers();
+BufferObject* _glGetBoundBuffer(GLenum target);
+const TriangleStrips* _glBufferStrips(BufferObject* buffer, const GLubyte* indices, const GLuint count, const GLenum type);
+
 GLboolean _glCheckValidEnum(GLint param, GLint* values, const char* func);
 
 GLuint* _glGetEnabledAttributes();
@@ -340,6 +410,7 @@ GLenum _glGetShadeModel();
 TextureObject* _glGetTexture0();
 TextureObject* _glGetTexture1();
 TextureObject* _glGetBoundTexture();
+TextureObject* _glGetTextureObject(GLuint index);
 
 extern GLubyte ACTIVE_TEXTURE;
 extern GLboolean TEXTURES_ENABLED[];
@@ -359,6 +430,7 @@ GLboolean _glIsCullingEnabled();
 GLboolean _glIsDepthTestEnabled();
 GLboolean _glIsDepthWriteEnabled();
 GLboolean _glIsScissorTestEnabled();
+GLint _glGetPackAlignment();
 GLboolean _glIsFogEnabled();
 GLenum _glGetDepthFunc();
 GLenum _glGetCullFace();
@@ -389,6 +461,7 @@ void _glEnableLight(GLubyte light, GLboolean value);
 GLboolean _glIsColorMaterialEnabled();
 
 GLboolean _glIsNormalizeEnabled();
+GLboolean _glIsStripifyEnabled();
 
 extern AttribPointerList ATTRIB_POINTERS;
 
@@ -452,6 +525,54 @@ GL_FORCE_INLINE GLuint _glRecalcFastPath() {
 
 extern GLboolean IMMEDIATE_MODE_ACTIVE;
 
+/* Set while a display list is being compiled. Calls which can be compiled
+ * check it and hand themselves to _glListRecord, which returns GL_FALSE if
+ * they shouldn't be executed as well */
+extern GLboolean LIST_COMPILING;
+
+typedef enum {
+    LIST_CMD_DRAW,
+    LIST_CMD_CALL_LIST,
+    LIST_CMD_MATRIX_MODE,
+    LIST_CMD_LOAD_IDENTITY,
+    LIST_CMD_LOAD_MATRIX,
+    LIST_CMD_MULT_MATRIX,
+    LIST_CMD_PUSH_MATRIX,
+    LIST_CMD_POP_MATRIX,
+    LIST_CMD_TRANSLATE,
+    LIST_CMD_ROTATE,
+    LIST_CMD_SCALE,
+    LIST_CMD_ACTIVE_TEXTURE,
+    LIST_CMD_BIND_TEXTURE,
+    LIST_CMD_ENABLE,
+    LIST_CMD_DISABLE,
+    LIST_CMD_BLEND_FUNC,
+    LIST_CMD_DEPTH_FUNC,
+    LIST_CMD_DEPTH_MASK,
+    LIST_CMD_SHADE_MODEL,
+    LIST_CMD_LIGHT,
+    LIST_CMD_LIGHT_MODEL,
+    LIST_CMD_LIGHT_MODEL_INT,
+    LIST_CMD_MATERIAL,
+    LIST_CMD_COLOR_MATERIAL,
+    LIST_CMD_FOG,
+    LIST_CMD_ALPHA_FUNC,
+    LIST_CMD_TEX_PARAMETER,
+    LIST_CMD_TEX_ENV,
+    LIST_CMD_CULL_FACE,
+    LIST_CMD_FRONT_FACE,
+    LIST_CMD_POLYGON_OFFSET,
+    LIST_CMD_COLOR_MASK,
+    LIST_CMD_SCISSOR
+} ListCommandType;
+
+void _glInitDisplayLists();
+GLboolean _glListRecord(ListCommandType type, const void* args, GLuint size);
+GLboolean _glListRecordDraw(GLenum mode, GLsizei first, GLuint count, GLenum type, const GLvoid* indices);
+GLuint _glGetListIndex();
+GLenum _glGetListMode();
+GLuint _glGetListBase();
+
 extern GLenum LAST_ERROR;
 extern char ERROR_FUNCTION[64];
 
@@ -522,6 +643,12 @@ void _glRecalcEnabledLights();
 GLfloat* _glLightModelSceneAmbient();
 GLfloat* _glGetLightModelSceneAmbient();
 LightSource* _glLightAt(GLuint i);
+
+/* Called by everything which changes the light, material or light model
+ * state, so caches of lit vertices can tell when they're out of date */
+void _glLightingChanged();
+GLuint _glLightingGeneration();
+
 GLboolean _glNearZClippingEnabled();
 
 GLboolean _glGPUStateIsDirty();
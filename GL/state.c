@@ -23,6 +23,7 @@ static struct {
     GLboolean alpha_test_enabled;
     GLboolean polygon_offset_enabled;
     GLboolean normalize_enabled;
+    GLboolean stripify_enabled;
     GLboolean scissor_test_enabled;
     GLboolean fog_enabled;
     GLboolean depth_mask_enabled;
@@ -51,7 +52,11 @@ static struct {
     GLuint enabled_light_count;
     Material material;
 
+    /* Bumped whenever anything lighting a vertex depends on changes */
+    GLuint lighting_generation;
+
     GLenum shade_model;
+    GLint pack_alignment;
 } GPUState = {
     .is_dirty = GL_TRUE,
     .depth_func = GL_LESS,
@@ -66,6 +71,7 @@ static struct {
     .alpha_test_enabled = GL_FALSE,
     .polygon_offset_enabled = GL_FALSE,
     .normalize_enabled = GL_FALSE,
+    .stripify_enabled = GL_FALSE,
     .scissor_test_enabled = GL_FALSE,
     .fog_enabled = GL_FALSE,
     .depth_mask_enabled = GL_FALSE,
@@ -83,7 +89,9 @@ static struct {
     .lights = {0},
     .enabled_light_count = 0,
     .material = {0},
-    .shade_model = GL_SMOOTH
+    .lighting_generation = 0,
+    .shade_model = GL_SMOOTH,
+    .pack_alignment = 4
 };
 
 void _glGPUStateMarkClean() {
@@ -107,6 +115,14 @@ LightSource* _glLightAt(GLuint i) {
     return &GPUState.lights[i];
 }
 
+void _glLightingChanged() {
+    GPUState.lighting_generation++;
+}
+
+GLuint _glLightingGeneration() {
+    return GPUState.lighting_generation;
+}
+
 void _glEnableLight(GLubyte light, GLboolean value) {
     GPUState.lights[light].isEnabled = value;
 }
@@ -163,6 +179,10 @@ GLboolean _glIsScissorTestEnabled() {
     return GPUState.scissor_test_enabled;
 }
 
+GLint _glGetPackAlignment() {
+    return GPUState.pack_alignment;
+}
+
 void _glRecalcEnabledLights() {
     GPUState.enabled_light_count = 0;
     for(GLubyte i = 0; i < MAX_GLDC_LIGHTS; ++i) {
@@ -218,6 +238,10 @@ GLboolean _glIsNormalizeEnabled() {
     return GPUState.normalize_enabled;
 }
 
+GLboolean _glIsStripifyEnabled() {
+    return GPUState.stripify_enabled;
+}
+
 GLenum _glGetBlendSourceFactor() {
     return GPUState.blend_sfactor;
 }
@@ -395,6 +419,10 @@ void _glInitContext() {
 }
 
 GLAPI void APIENTRY glEnable(GLenum cap) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_ENABLE, &cap, sizeof(cap))) {
+        return;
+    }
+
     switch(cap) {
         case GL_TEXTURE_2D:
             if(TEXTURES_ENABLED[_glGetActiveTexture()] != GL_TRUE) {
@@ -430,6 +458,7 @@ GLAPI void APIENTRY glEnable(GLenum cap) {
         case GL_LIGHTING: {
             if(GPUState.lighting_enabled != GL_TRUE) {
                 GPUState.lighting_enabled = GL_TRUE;
+                GPUState.lighting_generation++;
                 GPUState.is_dirty = GL_TRUE;
             }
         } break;
@@ -442,6 +471,7 @@ GLAPI void APIENTRY glEnable(GLenum cap) {
         case GL_COLOR_MATERIAL:
             if(GPUState.color_material_enabled != GL_TRUE) {
                 GPUState.color_material_enabled = GL_TRUE;
+                GPUState.lighting_generation++;
                 GPUState.is_dirty = GL_TRUE;
             }
         break;
@@ -469,6 +499,7 @@ GLAPI void APIENTRY glEnable(GLenum cap) {
             LightSource* ptr = _glLightAt(cap & 0xF);
             if(ptr->isEnabled != GL_TRUE) {
                 ptr->isEnabled = GL_TRUE;
+                GPUState.lighting_generation++;
                 _glRecalcEnabledLights();
             }
         }
@@ -479,6 +510,9 @@ GLAPI void APIENTRY glEnable(GLenum cap) {
                 GPUState.is_dirty = GL_TRUE;
             }
         break;
+        case GL_STRIPIFY_TRIANGLES_KOS:
+            GPUState.stripify_enabled = GL_TRUE;
+        break;
         case GL_POLYGON_OFFSET_POINT:
         case GL_POLYGON_OFFSET_LINE:
         case GL_POLYGON_OFFSET_FILL:
@@ -499,6 +533,10 @@ GLAPI void APIENTRY glEnable(GLenum cap) {
 }
 
 GLAPI void APIENTRY glDisable(GLenum cap) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_DISABLE, &cap, sizeof(cap))) {
+        return;
+    }
+
     switch(cap) {
         case GL_TEXTURE_2D:
             if(TEXTURES_ENABLED[_glGetActiveTexture()] != GL_FALSE) {
@@ -534,6 +572,7 @@ GLAPI void APIENTRY glDisable(GLenum cap) {
         case GL_LIGHTING: {
             if(GPUState.lighting_enabled != GL_FALSE) {
                 GPUState.lighting_enabled = GL_FALSE;
+                GPUState.lighting_generation++;
                 GPUState.is_dirty = GL_TRUE;
             }
         } break;
@@ -546,6 +585,7 @@ GLAPI void APIENTRY glDisable(GLenum cap) {
         case GL_COLOR_MATERIAL:
             if(GPUState.color_material_enabled != GL_FALSE) {
                 GPUState.color_material_enabled = GL_FALSE;
+                GPUState.lighting_generation++;
                 GPUState.is_dirty = GL_TRUE;
             }
         break;
@@ -572,6 +612,7 @@ GLAPI void APIENTRY glDisable(GLenum cap) {
         case GL_LIGHT7:
             if(GPUState.lights[cap & 0xF].isEnabled) {
                 _glEnableLight(cap & 0xF, GL_FALSE);
+                GPUState.lighting_generation++;
                 GPUState.is_dirty = GL_TRUE;
             }
         break;
@@ -581,6 +622,9 @@ GLAPI void APIENTRY glDisable(GLenum cap) {
                 GPUState.is_dirty = GL_TRUE;
             }
         break;
+        case GL_STRIPIFY_TRIANGLES_KOS:
+            GPUState.stripify_enabled = GL_FALSE;
+        break;
         case GL_POLYGON_OFFSET_POINT:
         case GL_POLYGON_OFFSET_LINE:
         case GL_POLYGON_OFFSET_FILL:
@@ -642,6 +686,10 @@ GLAPI void APIENTRY glReadBuffer(GLenum mode) {
 }
 
 GLAPI void APIENTRY glDepthMask(GLboolean flag) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_DEPTH_MASK, (const GLuint[]) {flag}, sizeof(GLuint))) {
+        return;
+    }
+
     if(GPUState.depth_mask_enabled != flag) {
         GPUState.depth_mask_enabled = flag;
         GPUState.is_dirty = GL_TRUE;
@@ -649,6 +697,10 @@ GLAPI void APIENTRY glDepthMask(GLboolean flag) {
 }
 
 GLAPI void APIENTRY glDepthFunc(GLenum func) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_DEPTH_FUNC, &func, sizeof(func))) {
+        return;
+    }
+
     if(GPUState.depth_func != func) {
         GPUState.depth_func = func;
         GPUState.is_dirty = GL_TRUE;
@@ -672,6 +724,10 @@ GLAPI void APIENTRY glPolygonMode(GLenum face, GLenum mode) {
 
 /* Culling */
 GLAPI void APIENTRY glFrontFace(GLenum mode) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_FRONT_FACE, &mode, sizeof(mode))) {
+        return;
+    }
+
     if(GPUState.front_face != mode) {
         GPUState.front_face = mode;
         GPUState.is_dirty = GL_TRUE;
@@ -679,6 +735,10 @@ GLAPI void APIENTRY glFrontFace(GLenum mode) {
 }
 
 GLAPI void APIENTRY glCullFace(GLenum mode) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_CULL_FACE, &mode, sizeof(mode))) {
+        return;
+    }
+
     if(GPUState.cull_face != mode) {
         GPUState.cull_face = mode;
         GPUState.is_dirty = GL_TRUE;
@@ -687,6 +747,10 @@ GLAPI void APIENTRY glCullFace(GLenum mode) {
 
 /* Shading - Flat or Goraud */
 GLAPI void APIENTRY glShadeModel(GLenum mode) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_SHADE_MODEL, &mode, sizeof(mode))) {
+        return;
+    }
+
     if(GPUState.shade_model != mode) {
         GPUState.shade_model = mode;
         GPUState.is_dirty = GL_TRUE;
@@ -695,6 +759,10 @@ GLAPI void APIENTRY glShadeModel(GLenum mode) {
 
 /* Blending */
 GLAPI void APIENTRY glBlendFunc(GLenum sfactor, GLenum dfactor) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_BLEND_FUNC, (const GLuint[]) {sfactor, dfactor}, sizeof(GLuint) * 2)) {
+        return;
+    }
+
     if(GPUState.blend_dfactor != dfactor || GPUState.blend_sfactor != sfactor) {
         GPUState.blend_sfactor = sfactor;
         GPUState.blend_dfactor = dfactor;
@@ -704,6 +772,10 @@ GLAPI void APIENTRY glBlendFunc(GLenum sfactor, GLenum dfactor) {
 
 
 GLAPI void APIENTRY glAlphaFunc(GLenum func, GLclampf ref) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_ALPHA_FUNC, (const GLfloat[]) {(GLfloat) func, ref}, sizeof(GLfloat) * 2)) {
+        return;
+    }
+
     GLint validFuncs[] = {
         GL_GREATER,
         0
@@ -722,6 +794,10 @@ void glLineWidth(GLfloat width) {
 }
 
 void glPolygonOffset(GLfloat factor, GLfloat units) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_POLYGON_OFFSET, (const GLfloat[]) {factor, units}, sizeof(GLfloat) * 2)) {
+        return;
+    }
+
     GPUState.offset_factor = factor;
     GPUState.offset_units = units;
     GPUState.is_dirty = GL_TRUE;
@@ -740,6 +816,10 @@ void glGetTexParameteriv(GLenum target, GLenum pname, GLint *params) {
 }
 
 void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_COLOR_MASK, (const GLuint[]) {red, green, blue, alpha}, sizeof(GLuint) * 4)) {
+        return;
+    }
+
     _GL_UNUSED(red);
     _GL_UNUSED(green);
     _GL_UNUSED(blue);
@@ -747,12 +827,22 @@ void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha
 }
 
 void glPixelStorei(GLenum pname, GLint param) {
-    _GL_UNUSED(pname);
-    _GL_UNUSED(param);
+    /* Only the pack alignment is used, by glReadPixels */
+    if(pname == GL_PACK_ALIGNMENT) {
+        if(param != 1 && param != 2 && param != 4 && param != 8) {
+            _glKosThrowError(GL_INVALID_VALUE, __func__);
+            return;
+        }
+
+        GPUState.pack_alignment = param;
+    }
 }
 
 
 void APIENTRY glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_SCISSOR, (const GLuint[]) {(GLuint) x, (GLuint) y, (GLuint) width, (GLuint) height}, sizeof(GLuint) * 4)) {
+        return;
+    }
 
     if(GPUState.scissor_rect.x == x &&
         GPUState.scissor_rect.y == y &&
@@ -835,6 +925,10 @@ void _glApplyScissor(bool force) {
     aligned_vector_push_back(&_glPunchThruPolyList()->vector, &c, 1);
     aligned_vector_push_back(&_glTransparentPolyList()->vector, &c, 1);
 
+    /* The lists aren't empty any more, make sure the next polygons still
+     * get a header after the command */
+    _glGPUStateMarkDirty();
+
     GPUState.scissor_rect.applied = true;
 }
 
@@ -866,6 +960,8 @@ GLboolean APIENTRY glIsEnabled(GLenum cap) {
     case GL_POLYGON_OFFSET_LINE:
     case GL_POLYGON_OFFSET_FILL:
         return GPUState.polygon_offset_enabled;
+    case GL_STRIPIFY_TRIANGLES_KOS:
+        return GPUState.stripify_enabled;
     }
 
     return GL_FALSE;
@@ -939,6 +1035,31 @@ void APIENTRY glGetIntegerv(GLenum pname, GLint *params) {
         case GL_TEXTURE_BINDING_2D:
             *params = (_glGetBoundTexture()) ? _glGetBoundTexture()->index : 0;
         break;
+        case GL_LIST_INDEX:
+            *params = _glGetListIndex();
+        break;
+        case GL_LIST_MODE:
+            *params = _glGetListMode();
+        break;
+        case GL_LIST_BASE:
+            *params = _glGetListBase();
+        break;
+        case GL_MAX_LIST_NESTING:
+            *params = MAX_GLDC_LIST_NESTING;
+        break;
+        case GL_ARRAY_ELEMENT_LOCK_FIRST_EXT:
+            *params = _glGetLockedFirst();
+        break;
+        case GL_ARRAY_ELEMENT_LOCK_COUNT_EXT:
+            *params = _glGetLockedCount();
+        break;
+        case GL_ARRAY_BUFFER_BINDING_ARB:
+        case GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB: {
+            BufferObject* buffer = _glGetBoundBuffer(
+                (pname == GL_ARRAY_BUFFER_BINDING_ARB) ? GL_ARRAY_BUFFER_ARB : GL_ELEMENT_ARRAY_BUFFER_ARB
+            );
+            *params = (buffer) ? buffer->index : 0;
+        } break;
         case GL_DEPTH_FUNC:
             *params = GPUState.depth_func;
         break;
@@ -951,6 +1072,9 @@ void APIENTRY glGetIntegerv(GLenum pname, GLint *params) {
         case GL_MAX_TEXTURE_SIZE:
             *params = MAX_TEXTURE_SIZE;
         break;
+        case GL_PACK_ALIGNMENT:
+            *params = GPUState.pack_alignment;
+        break;
         case GL_NUM_COMPRESSED_TEXTURE_FORMATS_ARB:
             *params = NUM_COMPRESSED_FORMATS;
         break;
@@ -994,7 +1118,7 @@ const GLubyte *glGetString(GLenum name) {
             return (const GLubyte*) "1.2 (partial) - GLdc 1.1";
 
         case GL_EXTENSIONS:
-            return (const GLubyte*)"GL_ARB_framebuffer_object, GL_ARB_multitexture, GL_ARB_texture_rg, GL_OES_compressed_paletted_texture, GL_EXT_paletted_texture, GL_EXT_shared_texture_palette, GL_KOS_multiple_shared_palette, GL_ARB_vertex_array_bgra, GL_ARB_vertex_type_2_10_10_10_rev, GL_KOS_texture_memory_management, GL_ATI_meminfo";
+            return (const GLubyte*)"GL_ARB_framebuffer_object, GL_ARB_multitexture, GL_ARB_texture_rg, GL_ARB_vertex_buffer_object, GL_EXT_compiled_vertex_array, GL_OES_compressed_paletted_texture, GL_EXT_paletted_texture, GL_EXT_shared_texture_palette, GL_KOS_multiple_shared_palette, GL_ARB_vertex_array_bgra, GL_ARB_vertex_type_2_10_10_10_rev, GL_KOS_texture_memory_management, GL_ATI_meminfo";
     }
 
     return (const GLubyte*) "GL_KOS_ERROR: ENUM Unsupported\n";
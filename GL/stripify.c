@@ -0,0 +1,278 @@
+/*
+ * Joins indexed triangles into strips. A triangle list sends three vertices
+ * per triangle, a strip only one for each triangle after its first, so a
+ * mesh drawn as long strips sends up to three times fewer.
+ *
+ * Triangles sharing an edge are found through a hash of their (directed)
+ * edges. As neighbouring triangles wind the same way, the one on the other
+ * side of the edge a->b is the one with the edge b->a, and it can always be
+ * appended to the strip keeping both windings. Strips are grown greedily
+ * from the first unused triangle, starting from whichever of its edges gives
+ * the longest strip.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "private.h"
+
+#define NO_TRIANGLE (~0u)
+#define USED (~0u)
+
+typedef struct {
+    GLuint a;
+    GLuint b;
+    GLuint triangle;
+} StripEdge;
+
+typedef struct {
+    const GLuint* vertices; /* 3 per triangle */
+    StripEdge* edges;
+    GLuint edge_mask;
+    GLuint* marks; /* USED, or the attempt which last walked over it */
+} StripMesh;
+
+static GLuint _glStripIndex(const GLubyte* indices, GLenum type, GLuint i) {
+    switch(type) {
+        case GL_UNSIGNED_BYTE:
+            return indices[i];
+        case GL_UNSIGNED_SHORT:
+            return ((const GLushort*) indices)[i];
+        default:
+            return ((const GLuint*) indices)[i];
+    }
+}
+
+static GLuint _glStripIndexSize(GLenum type) {
+    switch(type) {
+        case GL_UNSIGNED_BYTE:
+            return sizeof(GLubyte);
+        case GL_UNSIGNED_SHORT:
+            return sizeof(GLushort);
+        default:
+            return sizeof(GLuint);
+    }
+}
+
+GL_FORCE_INLINE GLuint _glStripEdgeHash(GLuint a, GLuint b) {
+    return (a * 0x9E3779B1u) ^ (b * 0x85EBCA77u);
+}
+
+static void _glStripAddEdge(StripMesh* mesh, GLuint a, GLuint b, GLuint triangle) {
+    GLuint i = _glStripEdgeHash(a, b) & mesh->edge_mask;
+
+    while(mesh->edges[i].triangle != NO_TRIANGLE) {
+        /* Edges shared by more than two triangles only keep the first */
+        if(mesh->edges[i].a == a && mesh->edges[i].b == b) {
+            return;
+        }
+
+        i = (i + 1) & mesh->edge_mask;
+    }
+
+    mesh->edges[i].a = a;
+    mesh->edges[i].b = b;
+    mesh->edges[i].triangle = triangle;
+}
+
+/* Returns the triangle on the other side of the edge a->b */
+static GLuint _glStripFindEdge(const StripMesh* mesh, GLuint a, GLuint b) {
+    GLuint i = _glStripEdgeHash(a, b) & mesh->edge_mask;
+
+    while(mesh->edges[i].triangle != NO_TRIANGLE) {
+        if(mesh->edges[i].a == a && mesh->edges[i].b == b) {
+            return mesh->edges[i].triangle;
+        }
+
+        i = (i + 1) & mesh->edge_mask;
+    }
+
+    return NO_TRIANGLE;
+}
+
+GL_FORCE_INLINE GLboolean _glStripDegenerate(const GLuint* v) {
+    return v[0] == v[1] || v[1] == v[2] || v[2] == v[0];
+}
+
+/* Walks the strip starting with triangle t rotated by r, marking the
+ * triangles it uses with mark. Their vertices are appended to out unless
+ * it's NULL. Returns the number of triangles in the strip */
+static GLuint _glStripWalk(StripMesh* mesh, GLuint t, GLuint r, GLuint mark, AlignedVector* out) {
+    const GLuint* v = mesh->vertices + (t * 3);
+
+    /* The last two vertices of the strip */
+    GLuint x = v[(r + 1) % 3];
+    GLuint y = v[(r + 2) % 3];
+
+    if(out) {
+        GLuint* it = aligned_vector_extend(out, 3);
+        it[0] = v[r];
+        it[1] = x;
+        it[2] = y;
+    }
+
+    mesh->marks[t] = mark;
+
+    GLuint length = 1;
+
+    for(;;) {
+        /* Even triangles have the edge x->y, odd ones y->x, and the next is
+         * the triangle on the other side of it */
+        const GLuint next = (length & 1) ? _glStripFindEdge(mesh, x, y) : _glStripFindEdge(mesh, y, x);
+
+        if(next == NO_TRIANGLE || mesh->marks[next] == USED || mesh->marks[next] == mark) {
+            break;
+        }
+
+        const GLuint* nv = mesh->vertices + (next * 3);
+        GLuint z = nv[0];
+        if(z == x || z == y) {
+            z = (nv[1] == x || nv[1] == y) ? nv[2] : nv[1];
+        }
+
+        if(out) {
+            aligned_vector_push_back(out, &z, 1);
+        }
+
+        mesh->marks[next] = mark;
+
+        x = y;
+        y = z;
+        ++length;
+    }
+
+    return length;
+}
+
+static void _glStripify(const GLuint* vertices, GLuint triangles, AlignedVector* indices, AlignedVector* ends) {
+    GLuint edge_count = 1;
+    while(edge_count < triangles * 6) {
+        edge_count <<= 1;
+    }
+
+    StripMesh mesh;
+    mesh.vertices = vertices;
+    mesh.edges = (StripEdge*) malloc(sizeof(StripEdge) * edge_count);
+    mesh.edge_mask = edge_count - 1;
+    mesh.marks = (GLuint*) calloc(triangles, sizeof(GLuint));
+
+    if(!mesh.edges || !mesh.marks) {
+        free(mesh.edges);
+        free(mesh.marks);
+        return;
+    }
+
+    for(GLuint i = 0; i < edge_count; ++i) {
+        mesh.edges[i].triangle = NO_TRIANGLE;
+    }
+
+    /* Triangles are stored under their edges backwards, which is how the
+     * neighbour on the other side of each sees it */
+    for(GLuint t = 0; t < triangles; ++t) {
+        const GLuint* v = vertices + (t * 3);
+
+        if(_glStripDegenerate(v)) {
+            continue;
+        }
+
+        _glStripAddEdge(&mesh, v[1], v[0], t);
+        _glStripAddEdge(&mesh, v[2], v[1], t);
+        _glStripAddEdge(&mesh, v[0], v[2], t);
+    }
+
+    const GLuint base = indices->size;
+    GLuint attempt = 0;
+
+    for(GLuint t = 0; t < triangles; ++t) {
+        if(mesh.marks[t] == USED) {
+            continue;
+        }
+
+        GLuint best = 0;
+
+        if(!_glStripDegenerate(vertices + (t * 3))) {
+            GLuint longest = 0;
+
+            for(GLuint r = 0; r < 3; ++r) {
+                const GLuint length = _glStripWalk(&mesh, t, r, ++attempt, NULL);
+
+                if(length > longest) {
+                    longest = length;
+                    best = r;
+                }
+            }
+        }
+
+        _glStripWalk(&mesh, t, best, USED, indices);
+
+        const GLuint end = indices->size - base - 1;
+        aligned_vector_push_back(ends, &end, 1);
+    }
+
+    free(mesh.edges);
+    free(mesh.marks);
+}
+
+static StripList* _glBuildStrips(BufferObject* buffer, GLuint offset, const GLuint count, const GLenum type) {
+    StripList list;
+    list.offset = offset;
+    list.count = count;
+    list.type = type;
+    list.first_index = buffer->strip_indices.size;
+    list.first_end = buffer->strip_ends.size;
+
+    const GLuint triangles = count / 3;
+
+    /* Indices too big for the buffer, or too few, are drawn as they are */
+    if(triangles && offset + (count * _glStripIndexSize(type)) <= (GLuint) buffer->size) {
+        GLuint* vertices = (GLuint*) malloc(sizeof(GLuint) * triangles * 3);
+
+        if(vertices) {
+            for(GLuint i = 0; i < triangles * 3; ++i) {
+                vertices[i] = _glStripIndex(buffer->data + offset, type, i);
+            }
+
+            _glStripify(vertices, triangles, &buffer->strip_indices, &buffer->strip_ends);
+            free(vertices);
+        }
+    }
+
+    list.index_count = buffer->strip_indices.size - list.first_index;
+    list.end_count = buffer->strip_ends.size - list.first_end;
+
+    return (StripList*) aligned_vector_push_back(&buffer->strips, &list, 1);
+}
+
+/* Returns the strips the triangles indexed from the element buffer at
+ * indices join into, working them out if this range hasn't been drawn
+ * before, or NULL if they couldn't be */
+const TriangleStrips* _glBufferStrips(BufferObject* buffer, const GLubyte* indices, const GLuint count, const GLenum type) {
+    static TriangleStrips strips;
+
+    const GLuint offset = indices - buffer->data;
+
+    StripList* list = NULL;
+    for(GLuint i = 0; i < buffer->strips.size; ++i) {
+        StripList* it = (StripList*) aligned_vector_at(&buffer->strips, i);
+
+        if(it->offset == offset && it->count == count && it->type == type) {
+            list = it;
+            break;
+        }
+    }
+
+    if(!list) {
+        list = _glBuildStrips(buffer, offset, count, type);
+    }
+
+    if(!list || !list->end_count) {
+        return NULL;
+    }
+
+    strips.indices = (const GLuint*) aligned_vector_at(&buffer->strip_indices, list->first_index);
+    strips.count = list->index_count;
+    strips.ends = (const GLuint*) aligned_vector_at(&buffer->strip_ends, list->first_end);
+    strips.end_count = list->end_count;
+
+    return &strips;
+}
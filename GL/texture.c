@@ -45,6 +45,10 @@ static void* yalloc_alloc_and_defrag(size_t size) {
 
     gl_assert(ret && "Out of PVR memory!");
 
+    if(ret) {
+        GPUTextureMemoryChanged(ret, size);
+    }
+
     return ret;
 }
 
@@ -493,9 +497,17 @@ TextureObject* _glGetBoundTexture() {
     return TEXTURE_UNITS[ACTIVE_TEXTURE];
 }
 
+TextureObject* _glGetTextureObject(GLuint index) {
+    return (glIsTexture(index)) ? (TextureObject*) named_array_get(&TEXTURE_OBJECTS, index) : NULL;
+}
+
 void APIENTRY glActiveTextureARB(GLenum texture) {
     TRACE();
 
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_ACTIVE_TEXTURE, &texture, sizeof(texture))) {
+        return;
+    }
+
     if(texture < GL_TEXTURE0_ARB || texture > GL_TEXTURE0_ARB + MAX_GLDC_TEXTURE_UNITS) {
         _glKosThrowError(GL_INVALID_ENUM, "glActiveTextureARB");
         return;
@@ -589,6 +601,10 @@ void APIENTRY glDeleteTextures(GLsizei n, GLuint *textures) {
 void APIENTRY glBindTexture(GLenum  target, GLuint texture) {
     TRACE();
 
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_BIND_TEXTURE, (const GLuint[]) {target, texture}, sizeof(GLuint) * 2)) {
+        return;
+    }
+
     GLint target_values [] = {GL_TEXTURE_2D, 0};
 
     if(_glCheckValidEnum(target, target_values, __func__) != 0) {
@@ -614,6 +630,10 @@ void APIENTRY glBindTexture(GLenum  target, GLuint texture) {
 void APIENTRY glTexEnvi(GLenum target, GLenum pname, GLint param) {
     TRACE();
 
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_TEX_ENV, (const GLuint[]) {target, pname, (GLuint) param}, sizeof(GLuint) * 3)) {
+        return;
+    }
+
     GLubyte failures = 0;
 
     GLint target_values [] = {GL_TEXTURE_ENV, GL_TEXTURE_FILTER_CONTROL_EXT, 0};
@@ -1470,6 +1490,8 @@ void APIENTRY glTexImage2D(GLenum target, GLint level, GLint internalFormat,
     GLubyte* targetData = (active->baseDataOffset == 0) ? active->data : _glGetMipmapLocation(active, level);
     gl_assert(targetData);
 
+    GPUTextureMemoryChanged(targetData, bytes);
+
     GLubyte* conversionBuffer = NULL;
 
     if(!data) {
@@ -1560,6 +1582,10 @@ void APIENTRY glTexImage2D(GLenum target, GLint level, GLint internalFormat,
 void APIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param) {
     TRACE();
 
+    if(LIST_COMPILING && !_glListRecord(LIST_CMD_TEX_PARAMETER, (const GLuint[]) {target, pname, (GLuint) param}, sizeof(GLuint) * 3)) {
+        return;
+    }
+
     TextureObject* active = _glGetBoundTexture();
 
     if(!active) {
@@ -1886,14 +1912,63 @@ GLAPI void APIENTRY glCopyTexImage1D(GLenum target, GLint level, GLenum internal
 }
 
 GLAPI void APIENTRY glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *pixels) {
-    _GL_UNUSED(x);
-    _GL_UNUSED(y);
-    _GL_UNUSED(width);
-    _GL_UNUSED(height);
-    _GL_UNUSED(format);
-    _GL_UNUSED(type);
-    _GL_UNUSED(pixels);
-    gl_assert(0 && "Not Implemented");
+    TRACE();
+
+    /* GLsizei is unsigned here, so negative sizes show up as huge ones */
+    if((GLint) width < 0 || (GLint) height < 0) {
+        _glKosThrowError(GL_INVALID_VALUE, __func__);
+        return;
+    }
+
+    GPUReadFormat read_format;
+    GLuint bytes_per_pixel;
+
+    if(format == GL_RGBA && type == GL_UNSIGNED_BYTE) {
+        read_format = GPU_READ_RGBA8888;
+        bytes_per_pixel = 4;
+    } else if(format == GL_BGRA && type == GL_UNSIGNED_BYTE) {
+        read_format = GPU_READ_BGRA8888;
+        bytes_per_pixel = 4;
+    } else if(format == GL_RGB && type == GL_UNSIGNED_BYTE) {
+        read_format = GPU_READ_RGB888;
+        bytes_per_pixel = 3;
+    } else if(format == GL_RGB && type == GL_UNSIGNED_SHORT_5_6_5) {
+        read_format = GPU_READ_RGB565;
+        bytes_per_pixel = 2;
+    } else {
+        _glKosThrowError(GL_INVALID_ENUM, __func__);
+        return;
+    }
+
+    const GLint alignment = _glGetPackAlignment();
+    const size_t stride = ((width * bytes_per_pixel) + alignment - 1) & ~(alignment - 1);
+
+    /* Pixels outside the framebuffer are undefined, so they're left alone
+     * and only the part of the rectangle inside it is read */
+    const VideoMode* vid_mode = GetVideoMode();
+
+    const int64_t x_end = (int64_t) x + (GLint) width;
+    const int64_t y_end = (int64_t) y + (GLint) height;
+
+    if(x_end <= 0 || y_end <= 0) {
+        return;
+    }
+
+    const GLint left = MAX(x, 0);
+    const GLint bottom = MAX(y, 0);
+    const GLint right = (GLint) MIN(x_end, (int64_t) vid_mode->width);
+    const GLint top = (GLint) MIN(y_end, (int64_t) vid_mode->height);
+
+    if(left >= right || bottom >= top) {
+        return;
+    }
+
+    GLubyte* out = ((GLubyte*) pixels) + ((bottom - y) * stride) + ((left - x) * bytes_per_pixel);
+
+    /* GL counts rows from the bottom, the framebuffer from the top */
+    if(!GPUReadPixels(left, vid_mode->height - top, right - left, top - bottom, read_format, stride, out)) {
+        _glKosThrowError(GL_INVALID_OPERATION, __func__);
+    }
 }
 GLuint _glMaxTextureMemory() {
     return YALLOC_SIZE;
@@ -1925,6 +2000,9 @@ GLAPI GLvoid APIENTRY glDefragmentTextureMemory_KOS(void) {
     }
 
     yalloc_defrag_commit(YALLOC_BASE);
+
+    /* Textures have moved around */
+    GPUTextureMemoryChanged(YALLOC_BASE, YALLOC_SIZE);
 }
 
 GLAPI void APIENTRY glGetTexImage(GLenum tex, GLint lod, GLenum format, GLenum type, GLvoid* img) {
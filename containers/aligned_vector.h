@@ -117,9 +117,11 @@ AV_FORCE_INLINE void* aligned_vector_resize(AlignedVector* vector, const unsigne
     unsigned int previousCount = vector->size;
 
     if(vector->capacity < element_count) {
-        /* If we didn't have capacity, increase capacity (slow) */
-        vector->size = element_count;
+        /* If we didn't have capacity, increase capacity (slow). This must
+         * happen before updating the size, otherwise reserve would copy
+         * (and return a pointer) past the end of the old data */
         ret = aligned_vector_reserve(vector, element_count);
+        vector->size = element_count;
     } else if(previousCount < element_count) {
         /* So we grew, but had the capacity, just get a pointer to
          * where we were */
@@ -344,6 +344,14 @@ __BEGIN_DECLS
 #define GL_DEPTH_BITS                     0x0D56
 #define GL_STENCIL_BITS                   0x0D57
 
+/* Display lists */
+#define GL_COMPILE                        0x1300
+#define GL_COMPILE_AND_EXECUTE            0x1301
+#define GL_LIST_MODE                      0x0B30
+#define GL_MAX_LIST_NESTING               0x0B31
+#define GL_LIST_BASE                      0x0B32
+#define GL_LIST_INDEX                     0x0B33
+
 /* StringName */
 #define GL_VENDOR                         0x1F00
 #define GL_RENDERER                       0x1F01
@@ -625,6 +633,20 @@ GLAPI void APIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, cons
 GLAPI void APIENTRY glEnableClientState(GLenum cap);
 GLAPI void APIENTRY glDisableClientState(GLenum cap);
 
+/* Display Lists - draws are stored already converted to the PVR vertex format.
+   Matrix, texture binding, parameter and environment, enable, blend/depth/
+   shading, alpha test, lighting, material, fog, culling, polygon offset, colour
+   mask and scissor calls are compiled. Texture uploads, object creation, pixel
+   store and client array state are executed immediately while compiling */
+GLAPI GLuint APIENTRY glGenLists(GLsizei range);
+GLAPI void APIENTRY glDeleteLists(GLuint list, GLsizei range);
+GLAPI GLboolean APIENTRY glIsList(GLuint list);
+GLAPI void APIENTRY glNewList(GLuint list, GLenum mode);
+GLAPI void APIENTRY glEndList(void);
+GLAPI void APIENTRY glCallList(GLuint list);
+GLAPI void APIENTRY glCallLists(GLsizei n, GLenum type, const GLvoid *lists);
+GLAPI void APIENTRY glListBase(GLuint base);
+
 /* Transformation / Matrix Functions */
 
 GLAPI void APIENTRY glMatrixMode(GLenum mode);
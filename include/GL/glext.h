@@ -9,6 +9,7 @@
 #define __GL_GLEXT_H
 
 #include <sys/cdefs.h>
+#include <stddef.h>
 __BEGIN_DECLS
 
 #define GL_TEXTURE0_ARB                   0x84C0
@@ -121,6 +122,51 @@ __BEGIN_DECLS
 #define GL_FRAMEBUFFER_UNSUPPORTED_EXT                   0x8CDD
 #define GL_INVALID_FRAMEBUFFER_OPERATION_EXT             0x0506
 
+/* ARB_vertex_buffer_object */
+#define GLintptrARB   ptrdiff_t
+#define GLsizeiptrARB ptrdiff_t
+
+#define GL_BUFFER_SIZE_ARB                    0x8764
+#define GL_BUFFER_USAGE_ARB                   0x8765
+#define GL_ARRAY_BUFFER_ARB                   0x8892
+#define GL_ELEMENT_ARRAY_BUFFER_ARB           0x8893
+#define GL_ARRAY_BUFFER_BINDING_ARB           0x8894
+#define GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB   0x8895
+#define GL_STREAM_DRAW_ARB                    0x88E0
+#define GL_STREAM_READ_ARB                    0x88E1
+#define GL_STREAM_COPY_ARB                    0x88E2
+#define GL_STATIC_DRAW_ARB                    0x88E4
+#define GL_STATIC_READ_ARB                    0x88E5
+#define GL_STATIC_COPY_ARB                    0x88E6
+#define GL_DYNAMIC_DRAW_ARB                   0x88E8
+#define GL_DYNAMIC_READ_ARB                   0x88E9
+#define GL_DYNAMIC_COPY_ARB                   0x88EA
+
+/* With a buffer bound to GL_ARRAY_BUFFER_ARB the pointer passed to
+ * gl*Pointer is an offset into it, and with one bound to
+ * GL_ELEMENT_ARRAY_BUFFER_ARB so are the indices passed to glDrawElements.
+ * The contents of GL_STATIC_DRAW_ARB buffers are converted to GLdc's vertex
+ * format the first time they're drawn and reused until they change. */
+GLAPI void APIENTRY glGenBuffersARB(GLsizei n, GLuint* buffers);
+GLAPI void APIENTRY glDeleteBuffersARB(GLsizei n, const GLuint* buffers);
+GLAPI void APIENTRY glBindBufferARB(GLenum target, GLuint buffer);
+GLAPI void APIENTRY glBufferDataARB(GLenum target, GLsizeiptrARB size, const GLvoid* data, GLenum usage);
+GLAPI void APIENTRY glBufferSubDataARB(GLenum target, GLintptrARB offset, GLsizeiptrARB size, const GLvoid* data);
+GLAPI void APIENTRY glGetBufferSubDataARB(GLenum target, GLintptrARB offset, GLsizeiptrARB size, GLvoid* data);
+GLAPI void APIENTRY glGetBufferParameterivARB(GLenum target, GLenum pname, GLint* params);
+GLAPI GLboolean APIENTRY glIsBufferARB(GLuint buffer);
+
+/* EXT_compiled_vertex_array */
+#define GL_ARRAY_ELEMENT_LOCK_FIRST_EXT       0x81A8
+#define GL_ARRAY_ELEMENT_LOCK_COUNT_EXT       0x81A9
+
+/* While arrays are locked the vertices in the locked range are read,
+ * transformed and lit once, and glDrawElements/glDrawArrays calls using
+ * them reuse that until the matrices or the lighting change. The arrays
+ * must not be modified (or their pointers changed) until they're unlocked */
+GLAPI void APIENTRY glLockArraysEXT(GLint first, GLsizei count);
+GLAPI void APIENTRY glUnlockArraysEXT(void);
+
 /* Multitexture extensions */
 GLAPI void APIENTRY glActiveTextureARB(GLenum texture);
 GLAPI void APIENTRY glClientActiveTextureARB(GLenum texture);
@@ -206,6 +252,34 @@ GLAPI void APIENTRY glCompressedTexImage2DARB(GLenum target,
 #define glGenerateMipmap glGenerateMipmapEXT
 #define glCompressedTexImage2D glCompressedTexImage2DARB
 
+#define GLintptr GLintptrARB
+#define GLsizeiptr GLsizeiptrARB
+
+#define GL_BUFFER_SIZE GL_BUFFER_SIZE_ARB
+#define GL_BUFFER_USAGE GL_BUFFER_USAGE_ARB
+#define GL_ARRAY_BUFFER GL_ARRAY_BUFFER_ARB
+#define GL_ELEMENT_ARRAY_BUFFER GL_ELEMENT_ARRAY_BUFFER_ARB
+#define GL_ARRAY_BUFFER_BINDING GL_ARRAY_BUFFER_BINDING_ARB
+#define GL_ELEMENT_ARRAY_BUFFER_BINDING GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB
+#define GL_STREAM_DRAW GL_STREAM_DRAW_ARB
+#define GL_STREAM_READ GL_STREAM_READ_ARB
+#define GL_STREAM_COPY GL_STREAM_COPY_ARB
+#define GL_STATIC_DRAW GL_STATIC_DRAW_ARB
+#define GL_STATIC_READ GL_STATIC_READ_ARB
+#define GL_STATIC_COPY GL_STATIC_COPY_ARB
+#define GL_DYNAMIC_DRAW GL_DYNAMIC_DRAW_ARB
+#define GL_DYNAMIC_READ GL_DYNAMIC_READ_ARB
+#define GL_DYNAMIC_COPY GL_DYNAMIC_COPY_ARB
+
+#define glGenBuffers glGenBuffersARB
+#define glDeleteBuffers glDeleteBuffersARB
+#define glBindBuffer glBindBufferARB
+#define glBufferData glBufferDataARB
+#define glBufferSubData glBufferSubDataARB
+#define glGetBufferSubData glGetBufferSubDataARB
+#define glGetBufferParameteriv glGetBufferParameterivARB
+#define glIsBuffer glIsBufferARB
+
 #ifndef GL_VERSION_1_4
 #define GL_VERSION_1_4 1
 #define GL_MAX_TEXTURE_LOD_BIAS           0x84FD
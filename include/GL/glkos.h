@@ -57,6 +57,24 @@ typedef struct {
     GLuint initial_pt_capacity;
     GLuint initial_immediate_capacity;
 
+    /* Number of threads the software backend renders tiles with. 0 (default)
+     * uses one per CPU core. Output is identical whatever the count. Ignored
+     * on the Dreamcast. */
+    GLuint software_thread_count;
+
+    /* Bytes of textures the software backend keeps decoded for sampling.
+     * Least recently used textures are dropped beyond this, and 0 turns
+     * the cache off. Ignored on the Dreamcast. */
+    GLuint software_texture_cache_size;
+
+    /* The software backend rasterizes at 1/n of the video mode on each
+     * axis, 1 (default), 2 or 4, and scales the frame up to show it. 0
+     * picks it every frame, to keep rasterizing a frame within
+     * software_target_frame_time microseconds (default 16666). Ignored
+     * on the Dreamcast. */
+    GLuint software_resolution_divisor;
+    GLuint software_target_frame_time;
+
 } GLdcConfig;
 
 
@@ -193,5 +211,13 @@ GLAPI GLvoid APIENTRY glDefragmentTextureMemory_KOS(void);
 //for palette internal format (glfcConfig)
 #define GL_RGB565_KOS                               0xEF40
 
+/* When enabled, glDrawElements(GL_TRIANGLES, ...) with an element array
+ * buffer bound is drawn as triangle strips, joined up from the triangles
+ * sharing edges. The strips are worked out the first time each range of the
+ * buffer is drawn and kept until the buffer's data changes. Only used with
+ * GL_SMOOTH shading, as strips can change which vertex a flat shaded triangle
+ * takes its colour from */
+#define GL_STRIPIFY_TRIANGLES_KOS                   0xEF41
+
 __END_DECLS
 